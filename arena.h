@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <bits/stdc++.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Vector whose memory comes from an arena
+template <class T>
+using avector = std::pmr::vector<T>;
+
+// Queue whose memory comes from an arena
+template <class T>
+using aqueue = std::queue<T, std::pmr::deque<T>>;
+
+/**
+ * Bump allocator that backs all the scratch state of a solver.
+ *
+ * Memory is handed out from a list of blocks and is never given back one
+ * allocation at a time; reset() takes everything back in bulk. When a run
+ * needed more than one block, reset() replaces them with a single block big
+ * enough for the whole run, so solving a same-sized instance afterwards does
+ * not touch the heap at all.
+ */
+class Arena : public std::pmr::memory_resource {
+ public:
+	Arena() = default;
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+
+	~Arena() override {
+		for (auto &block : blocks)
+			::operator delete(block.data);
+	}
+
+	/**
+	 * @brief
+	 * Time: O(number of blocks)
+	 *
+	 * Takes back every allocation. All containers that use the arena must be
+	 * emptied (or destroyed) beforehand.
+	 */
+	void reset() {
+		size_t total = 0;
+
+		for (auto &block : blocks)
+			total += block.size;
+
+		// Coalesces the blocks into one that fits everything at once
+		if (blocks.size() > 1) {
+			for (auto &block : blocks)
+				::operator delete(block.data);
+			blocks.clear();
+			add_block(total);
+		}
+
+		if (!blocks.empty())
+			blocks[0].used = 0;
+		current = 0;
+		used_bytes = 0;
+	}
+
+	/**
+	 * @brief
+	 * Time: O(number of blocks)
+	 *
+	 * Takes back every allocation, like reset(), and also gives the pages of
+	 * the blocks back to the system: the blocks are kept, so the next run
+	 * does not allocate, but they take no memory until they are used again
+	 * (their pages then come back zeroed).
+	 */
+	void trim() {
+		reset();
+
+		uintptr_t page = sysconf(_SC_PAGESIZE);
+		for (auto &block : blocks) {
+			uintptr_t first = ((uintptr_t)block.data + page - 1) & ~(page - 1);
+			uintptr_t last = ((uintptr_t)block.data + block.size) & ~(page - 1);
+
+			if (first < last)
+				madvise((void *)first, last - first, MADV_DONTNEED);
+		}
+	}
+
+	// Number of bytes handed out since the last reset
+	size_t used() const {
+		return used_bytes;
+	}
+
+	// Number of bytes held by the arena
+	size_t capacity() const {
+		size_t total = 0;
+
+		for (auto &block : blocks)
+			total += block.size;
+
+		return total;
+	}
+
+ private:
+	// Smallest block requested from the heap
+	static constexpr size_t MIN_BLOCK = (size_t)1 << 16;  // 64 KiB
+
+	struct Block {
+		char *data;
+		size_t size, used;
+	};
+
+	// blocks = memory owned by the arena, current = block being bumped
+	std::vector<Block> blocks;
+	size_t current = 0;
+
+	// used_bytes = live bytes
+	size_t used_bytes = 0;
+
+	void add_block(size_t size) {
+		size = std::max(size, MIN_BLOCK);
+
+		// The block list itself only grows during warm-up
+		blocks.push_back({static_cast<char *>(::operator new(size)), size, 0});
+	}
+
+	void *do_allocate(size_t bytes, size_t align) override {
+		while (current < blocks.size()) {
+			auto &block = blocks[current];
+			size_t start = (block.used + align - 1) & ~(align - 1);
+
+			if (start + bytes <= block.size) {
+				block.used = start + bytes;
+				used_bytes += bytes;
+				return block.data + start;
+			}
+
+			// Moves on to the next block, which is empty after a reset
+			if (++current < blocks.size())
+				blocks[current].used = 0;
+		}
+
+		// Grows geometrically so that a run needs few blocks
+		size_t last = blocks.empty() ? 0 : blocks.back().size;
+		add_block(std::max(bytes + align, 2 * last));
+		current = blocks.size() - 1;
+
+		return do_allocate(bytes, align);
+	}
+
+	// Memory is only given back in bulk, by reset()
+	void do_deallocate(void *, size_t, size_t) override {}
+
+	bool do_is_equal(const std::pmr::memory_resource &other)
+		const noexcept override {
+		return this == &other;
+	}
+};
+
+#endif  // ARENA_H_
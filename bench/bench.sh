@@ -0,0 +1,91 @@
+#!/bin/bash
+# SPDX-License-Identifier: EUPL-1.2
+# Copyright Mitran Andrei-Gabriel 2023
+#
+# Scaling benchmark: generates seeded instances of every problem at growing
+# sizes, solves them and appends one CSV row per phase to $OUT. Besides the
+# generate and solve rows, every phase reported by the solver's
+# instrumentation (stats.h) gets its own row; its peak_rss_kb is the peak of
+# the process at the end of that phase.
+#
+# Environment:
+#   SCALES  node counts to try (default: 10^4 to 10^7)
+#   SEED    generator seed (default: 1)
+#   OUT     CSV file (default: bench/results.csv)
+#   ONLY    run only the cases whose problem name matches this regex
+#   COMPRESS solve with compressed adjacency lists (AP_COMPRESS, cgraph.h);
+#           the rows get "<shape>+c" as their shape
+#   ENGINE  teleportare engine (AP_TELEPORT_ENGINE), e.g. "rows"; the rows get
+#           "<shape>+<engine>" as their shape
+#   REORDER relabelling of the nodes (AP_REORDER: bfs, rcm or degree); the
+#           rows get "<shape>+<method>" as their shape
+
+set -eu
+
+BENCH=$(cd "$(dirname "$0")" && pwd)
+SCALES=${SCALES:-"10000 100000 1000000 10000000"}
+SEED=${SEED:-1}
+OUT=${OUT:-$BENCH/results.csv}
+ONLY=${ONLY:-.}
+COMPRESS=${COMPRESS:-0}
+ENGINE=${ENGINE:-}
+REORDER=${REORDER:-}
+
+# problem binary shape param
+CASES="
+supercomputer p1 dag 2
+ferate p2 scc 1
+ferate p2 scc 8
+ferate p2 scc 1000
+teleportare p3 grid 1
+teleportare p3 grid 4
+magazin p4 deep 0
+magazin p4 wide 0
+magazin p4 random 0
+"
+
+# The recursive DFS of ferate and magazin needs a deep stack on large inputs
+ulimit -s unlimited
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+[ -s "$OUT" ] || echo "problem,shape,param,nodes,edges,seed,phase,wall_s,peak_rss_kb,throughput" > "$OUT"
+
+# row <phase> <wall_s> <peak_rss_kb>; throughput is in nodes + edges per second
+row() {
+	echo "$problem,$label,$param,$nodes,$edges,$SEED,$1,$2,$3,$(awk -v e="$((nodes + edges))" -v t="$2" 'BEGIN { printf "%.0f", (t > 0 ? e / t : 0) }')" >> "$OUT"
+}
+
+echo "$CASES" | while read -r problem bin shape param; do
+	[ -n "$problem" ] || continue
+	[[ $problem =~ $ONLY ]] || continue
+	label=$shape
+	[ "$COMPRESS" = 0 ] || label=$label+c
+	[ -z "$ENGINE" ] || label=$label+$ENGINE
+	[ -z "$REORDER" ] || label=$label+$REORDER
+
+	for scale in $SCALES; do
+		read -r wall rss < <("$BENCH/measure" sh -c "'$BENCH/gen' $problem $scale $SEED $shape $param > '$WORK/$problem.in'")
+
+		# The first line holds the node count and what makes up the edges
+		read -r a b c < "$WORK/$problem.in"
+		case $problem in
+			supercomputer|ferate) nodes=$a; edges=$b ;;
+			teleportare) nodes=$a; edges=$((b + c)) ;;
+			magazin) nodes=$a; edges=$((a - 1 + b)) ;;
+		esac
+		row generate "$wall" "$rss"
+
+		read -r wall rss < <(cd "$WORK" && AP_STATS=1 AP_COMPRESS=$COMPRESS AP_TELEPORT_ENGINE=$ENGINE AP_REORDER=$REORDER "$BENCH/measure" "$BENCH/$bin" 2> "$WORK/stats")
+		row solve "$wall" "$rss"
+
+		# {"name":"read_input","wall_s":0.01,"peak_rss_kb":2048} -> row
+		grep -o '{"name":[^}]*}' "$WORK/stats" | tr -d '{}"' | tr ',:' '  ' |
+			while read -r _ name _ phase_wall _ phase_rss; do
+				row "$name" "$phase_wall" "$phase_rss"
+			done
+
+		echo "$problem $label $param n=$nodes: ${wall}s, ${rss} KiB" >&2
+	done
+done
@@ -0,0 +1,232 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+// Seeded generator of large inputs for the four problems.
+//
+// Usage: gen <problem> <nodes> <seed> [shape] [param]
+//
+//   supercomputer [dag]              param = number of data sets, 1 or 2 (2)
+//   ferate        [scc]              param = size of the SCCs (1 = no cycles)
+//   teleportare   [grid]             param = maximum portal period (4)
+//   magazin       [deep|wide|random] param = unused
+//
+// The instance is written to stdout, in the problem's input format.
+
+#include <bits/stdc++.h>
+
+using namespace std;
+
+// Buffered writer for plain integers, so that 10^7 nodes do not take longer
+// to print than to solve
+class Writer {
+ public:
+	~Writer() {
+		fwrite(buf, 1, len, stdout);
+	}
+
+	Writer &operator<<(long long x) {
+		char digits[24];
+		int cnt = 0;
+
+		if (x < 0) {
+			put('-');
+			x = -x;
+		}
+		do {
+			digits[cnt++] = '0' + x % 10;
+			x /= 10;
+		} while (x);
+		while (cnt)
+			put(digits[--cnt]);
+
+		return *this;
+	}
+
+	Writer &operator<<(int x) {
+		return *this << (long long)x;
+	}
+
+	Writer &operator<<(char c) {
+		put(c);
+		return *this;
+	}
+
+ private:
+	static constexpr int SIZE = 1 << 16;
+	char buf[SIZE];
+	int len = 0;
+
+	void put(char c) {
+		if (len == SIZE) {
+			fwrite(buf, 1, len, stdout);
+			len = 0;
+		}
+		buf[len++] = c;
+	}
+};
+
+mt19937_64 rng;
+
+// Random integer in [lo, hi]
+long long rnd(long long lo, long long hi) {
+	return uniform_int_distribution<long long>(lo, hi)(rng);
+}
+
+// Random relabelling of the nodes 1..n, so that ids carry no locality
+vector<int> shuffled_labels(int n) {
+	vector<int> label(n + 1);
+
+	iota(label.begin(), label.end(), 0);
+	shuffle(label.begin() + 1, label.end(), rng);
+
+	return label;
+}
+
+/**
+ * A DAG with 2 arcs per node on average, every arc going from a smaller to a
+ * larger topological rank; the ranks are then shuffled. Every task needs data
+ * set 1 or 2 (sets = 1 gives only the first): the solver has a queue for each
+ * of the two and would never schedule a task of a third one.
+ */
+void supercomputer(Writer &out, int n, int sets) {
+	int m = n > 1 ? 2 * n : 0;
+	auto label = shuffled_labels(n);
+
+	sets = min(max(sets, 1), 2);
+
+	out << n << ' ' << m << '\n';
+	for (int i = 1; i <= n; ++i)
+		out << rnd(1, sets) << (i == n ? '\n' : ' ');
+
+	for (int i = 1; i <= m; ++i) {
+		int x = rnd(1, n - 1);
+		// Mostly short arcs, which gives long dependency chains
+		int y = min<long long>(n, x + rnd(1, min(n - x, 64)));
+
+		out << label[x] << ' ' << label[y] << '\n';
+	}
+}
+
+/**
+ * Rails grouped into SCCs of scc_size stations (each one a cycle), with the
+ * remaining arcs going forward, towards later SCCs.
+ */
+void ferate(Writer &out, int n, int scc_size) {
+	scc_size = max(1, scc_size);
+	auto label = shuffled_labels(n);
+	vector<pair<int, int>> arcs;
+
+	arcs.reserve(2 * n);
+	for (int first = 1; first <= n; first += scc_size) {
+		int last = min(n, first + scc_size - 1);
+
+		if (first == last)
+			continue;
+
+		// The cycle that makes the group strongly connected
+		for (int i = first; i < last; ++i)
+			arcs.push_back({i, i + 1});
+		arcs.push_back({last, first});
+	}
+
+	// Forward arcs between groups, up to 2 arcs per station in total
+	while ((int)arcs.size() < 2 * n && n > 1) {
+		int x = rnd(1, n - 1);
+		int y = rnd(x + 1, min<long long>(n, x + 4LL * scc_size));
+
+		arcs.push_back({x, y});
+	}
+
+	out << n << ' ' << (long long)arcs.size() << ' ' << label[rnd(1, n)]
+		<< '\n';
+	for (auto &arc : arcs)
+		out << label[arc.first] << ' ' << label[arc.second] << '\n';
+}
+
+/**
+ * A square grid with corridors of cost 1..9 between neighbouring rooms and a
+ * portal every 64 rooms, to a random room, with periods 1..max_period.
+ * Room 1 and room n are opposite corners.
+ */
+void teleportare(Writer &out, int n, int max_period) {
+	int side = max(2, (int)sqrt((double)n));
+	n = side * side;
+	max_period = min(8, max(1, max_period));
+
+	auto id = [side](int r, int c) { return r * side + c + 1; };
+	long long m = 2LL * side * (side - 1);
+	int k = n / 64;
+
+	out << n << ' ' << m << ' ' << k << '\n';
+	for (int r = 0; r < side; ++r) {
+		for (int c = 0; c < side; ++c) {
+			if (c + 1 < side)
+				out << id(r, c) << ' ' << id(r, c + 1) << ' ' << rnd(1, 9)
+					<< '\n';
+			if (r + 1 < side)
+				out << id(r, c) << ' ' << id(r + 1, c) << ' ' << rnd(1, 9)
+					<< '\n';
+		}
+	}
+
+	for (int i = 1; i <= k; ++i) {
+		int x = 64 * i;
+		int y = rnd(1, n);
+
+		out << x << ' ' << (y == x ? 1 : y) << ' ' << rnd(1, max_period)
+			<< '\n';
+	}
+}
+
+/**
+ * A tree rooted in 1, either a path (deep), a star (wide) or with random
+ * parents (random), followed by n queries.
+ */
+void magazin(Writer &out, int n, const string &shape) {
+	int q = n;
+
+	out << n << ' ' << q << '\n';
+	for (int i = 2; i <= n; ++i) {
+		int parent;
+
+		if (shape == "deep")
+			parent = i - 1;
+		else if (shape == "wide")
+			parent = 1;
+		else
+			parent = rnd(1, i - 1);
+
+		out << parent << (i == n ? '\n' : ' ');
+	}
+
+	for (int i = 1; i <= q; ++i)
+		out << rnd(1, n) << ' ' << rnd(1, 100) << '\n';
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 4) {
+		cerr << "usage: " << argv[0]
+			 << " <problem> <nodes> <seed> [shape] [param]\n";
+		return 1;
+	}
+
+	string problem = argv[1], shape = argc > 4 ? argv[4] : "";
+	int n = max(2, atoi(argv[2]));
+	rng.seed(strtoull(argv[3], nullptr, 10));
+	Writer out;
+
+	if (problem == "supercomputer") {
+		supercomputer(out, n, argc > 5 ? atoi(argv[5]) : 2);
+	} else if (problem == "ferate") {
+		ferate(out, n, argc > 5 ? atoi(argv[5]) : 8);
+	} else if (problem == "teleportare") {
+		teleportare(out, n, argc > 5 ? atoi(argv[5]) : 4);
+	} else if (problem == "magazin") {
+		magazin(out, n, shape.empty() ? "random" : shape);
+	} else {
+		cerr << "unknown problem: " << problem << '\n';
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+// Runs a command and reports its wall-clock time and peak resident memory.
+//
+// Usage: measure <command> [args...]
+//
+// Prints "<wall seconds> <peak RSS in KiB>" on stdout once the command ends;
+// the exit status is the command's.
+
+#include <bits/stdc++.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		cerr << "usage: " << argv[0] << " <command> [args...]\n";
+		return 1;
+	}
+
+	auto start = chrono::steady_clock::now();
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return 1;
+	}
+	if (pid == 0) {
+		execvp(argv[1], argv + 1);
+		perror("execvp");
+		_exit(127);
+	}
+
+	int status;
+	struct rusage usage;
+	if (wait4(pid, &status, 0, &usage) < 0) {
+		perror("wait4");
+		return 1;
+	}
+
+	chrono::duration<double> wall = chrono::steady_clock::now() - start;
+
+	// ru_maxrss is in KiB on Linux
+	printf("%.6f %ld\n", wall.count(), usage.ru_maxrss);
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
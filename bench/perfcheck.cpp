@@ -0,0 +1,508 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+// Performance regression gate over public_tests.
+//
+// Usage: perfcheck [options]
+//
+//   --runs N          runs of every test (default 3); medians are kept
+//   --threshold PCT   allowed slowdown, in percent (default 15)
+//   --baseline FILE   baseline of the counters (bench/perf_baseline.csv)
+//   --local FILE      baseline of the times, written on this host
+//                     (bench/perf_local.csv)
+//   --bin DIR         directory of p1 .. p4 (default bench/opt, built with
+//                     -O2 and without AP_STATS by make perfcheck)
+//   --modes LIST      comma-separated modes to measure (default all of them)
+//   --update          writes the measurements as the new baselines
+//
+// Every input of public_tests/<problem>/input is solved by the matching
+// binary in every mode that applies to it (see MODES) and checked against
+// its .ref file. The wall and CPU (user + system) times and, through
+// perf_event_open, the instructions, cache misses and branch misses of every
+// run are measured; if the counters are not available (no PMU, or
+// perf_event_paranoid too high), only the times are. The medians are summed
+// per solver and mode and compared with the baselines. The counters, which
+// hardly depend on the machine, are checked in (--baseline); the times are
+// kept apart (--local, not checked in), with the name of the host that wrote
+// them, as they only mean something on that host. The instructions decide
+// when both sides have them; otherwise the CPU time does, as it is less
+// sensitive to the load of the machine than the wall time, but only against
+// times of the same host: without them the times are advisory. The exit
+// status is 1 if a test gives a wrong answer or a solver got slower than the
+// threshold allows.
+
+#include <bits/stdc++.h>
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Metrics, in the order in which they are reported
+static const char *METRICS[] = {"wall_s", "cpu_s", "instructions",
+								"cache_misses", "branch_misses"};
+static constexpr int NMETRICS = 5, WALL = 0, CPU = 1, INSTRUCTIONS = 2;
+
+// Hardware events behind the metrics from INSTRUCTIONS on
+static const unsigned long long EVENTS[] = {PERF_COUNT_HW_INSTRUCTIONS,
+											PERF_COUNT_HW_CACHE_MISSES,
+											PERF_COUNT_HW_BRANCH_MISSES};
+
+struct Solver {
+	const char *problem, *binary;
+};
+
+static const Solver SOLVERS[] = {{"supercomputer", "p1"}, {"ferate", "p2"},
+								 {"teleportare", "p3"}, {"magazin", "p4"}};
+
+// A way of running the solvers: the environment it sets and the binaries it
+// applies to. The overlay of teleportare is forced, as the single query of a
+// public test never pays for building it. The cache and the snapshots also
+// get a directory (named by dir): for a miss it is emptied before every run,
+// for a hit it is filled by a first run, which is not measured.
+struct Mode {
+	const char *name, *binaries;
+	vector<pair<const char *, const char *>> env;
+	const char *dir;
+	bool hit;
+};
+
+static const Mode MODES[] = {
+	{"plain", "p1 p2 p3 p4", {}, nullptr, false},
+	{"compress", "p1 p2 p3", {{"AP_COMPRESS", "1"}}, nullptr, false},
+	{"bfs", "p1 p2 p3 p4", {{"AP_REORDER", "bfs"}}, nullptr, false},
+	{"rcm", "p1 p2 p3 p4", {{"AP_REORDER", "rcm"}}, nullptr, false},
+	{"degree", "p1 p2 p3 p4", {{"AP_REORDER", "degree"}}, nullptr, false},
+	{"rows", "p3", {{"AP_TELEPORT_ENGINE", "rows"}}, nullptr, false},
+	{"overlay", "p3", {{"AP_TELEPORT_OVERLAY", "always"}}, nullptr, false},
+	{"cache_miss", "p1 p2 p3 p4", {}, "AP_CACHE_DIR", false},
+	{"cache_hit", "p1 p2 p3 p4", {}, "AP_CACHE_DIR", true},
+	{"snapshot_miss", "p2 p4", {}, "AP_SNAPSHOT_DIR", false},
+	{"snapshot_hit", "p2 p4", {}, "AP_SNAPSHOT_DIR", true},
+};
+
+// Measurements of a run; a metric is -1 when it could not be measured
+using Sample = array<double, NMETRICS>;
+
+/**
+ * @brief Opens a disabled counter for pid, enabled when it calls exec.
+ *
+ * @return the file descriptor, or -1 if the event is not available
+ */
+static int open_counter(pid_t pid, unsigned long long config) {
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.enable_on_exec = 1;
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+}
+
+/**
+ * @brief Runs binary in dir once, with the variables of env set.
+ *
+ * The child waits on a pipe until the counters are attached to it, so that
+ * they only count the solver (they are enabled by exec).
+ *
+ * @return the measurements, or nullopt if the binary did not exit cleanly
+ */
+static optional<Sample> run_once(const string &binary, const string &dir,
+								 const vector<pair<string, string>> &env) {
+	int go[2];
+	if (pipe(go) < 0) {
+		perror("pipe");
+		exit(2);
+	}
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(2);
+	}
+	if (pid == 0) {
+		char c;
+
+		close(go[1]);
+		if (read(go[0], &c, 1) < 0)
+			_exit(127);
+		if (chdir(dir.c_str()) < 0)
+			_exit(127);
+		for (auto &[name, value] : env)
+			setenv(name.c_str(), value.c_str(), 1);
+		execl(binary.c_str(), binary.c_str(), (char *)nullptr);
+		_exit(127);
+	}
+	close(go[0]);
+
+	int fds[NMETRICS - INSTRUCTIONS];
+	for (int i = 0; i < NMETRICS - INSTRUCTIONS; ++i)
+		fds[i] = open_counter(pid, EVENTS[i]);
+
+	auto start = chrono::steady_clock::now();
+	if (write(go[1], "x", 1) < 0)
+		perror("write");
+	close(go[1]);
+
+	int status;
+	struct rusage usage;
+	wait4(pid, &status, 0, &usage);
+	chrono::duration<double> wall = chrono::steady_clock::now() - start;
+
+	Sample sample;
+	sample[WALL] = wall.count();
+	sample[CPU] = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+				  (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+	for (int i = 0; i < NMETRICS - INSTRUCTIONS; ++i) {
+		long long value;
+
+		sample[INSTRUCTIONS + i] = -1;
+		if (fds[i] < 0)
+			continue;
+		if (read(fds[i], &value, sizeof(value)) == sizeof(value))
+			sample[INSTRUCTIONS + i] = value;
+		close(fds[i]);
+	}
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status))
+		return nullopt;
+	return sample;
+}
+
+// Whitespace-separated tokens of a file
+static vector<string> tokens(const string &path) {
+	ifstream fin(path);
+	vector<string> all;
+	string token;
+
+	while (fin >> token)
+		all.push_back(token);
+
+	return all;
+}
+
+// Copies a file, returning false on failure
+static bool copy_file(const string &from, const string &to) {
+	ifstream fin(from, ios::binary);
+	ofstream fout(to, ios::binary);
+
+	fout << fin.rdbuf();
+	return fin && fout;
+}
+
+// Removes the files in dir (the cache or the snapshots of a mode)
+static void empty_dir(const string &dir) {
+	DIR *d = opendir(dir.c_str());
+
+	if (!d)
+		return;
+	while (auto *entry = readdir(d))
+		if (entry->d_name[0] != '.')
+			unlink((dir + "/" + entry->d_name).c_str());
+	closedir(d);
+}
+
+// Names of the .in files in dir, sorted
+static vector<string> inputs(const string &dir) {
+	vector<string> names;
+	DIR *d = opendir(dir.c_str());
+
+	if (!d)
+		return names;
+	while (auto *entry = readdir(d)) {
+		string name = entry->d_name;
+
+		if (name.size() > 3 && name.substr(name.size() - 3) == ".in")
+			names.push_back(name);
+	}
+	closedir(d);
+	sort(names.begin(), names.end());
+
+	return names;
+}
+
+// (solver, mode, metric)
+using Key = array<string, 3>;
+
+// Baseline file: one "solver,mode,metric,value" line per measured metric
+static map<Key, double> read_baseline(const string &path) {
+	map<Key, double> baseline;
+	ifstream fin(path);
+	string line;
+
+	while (getline(fin, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		stringstream ss(line);
+		string solver, mode, metric, value;
+		getline(ss, solver, ',');
+		getline(ss, mode, ',');
+		getline(ss, metric, ',');
+		getline(ss, value);
+		baseline[{solver, mode, metric}] = atof(value.c_str());
+	}
+
+	return baseline;
+}
+
+// Host named by the "# host NAME" line of a baseline, or "" if none
+static string baseline_host(const string &path) {
+	ifstream fin(path);
+	string line;
+
+	while (getline(fin, line))
+		if (line.rfind("# host ", 0) == 0)
+			return line.substr(7);
+	return "";
+}
+
+// Name of this host
+static string host_name() {
+	char name[256] = "";
+
+	gethostname(name, sizeof(name) - 1);
+	return name;
+}
+
+/**
+ * @brief Writes the metrics first .. last - 1 of total to path, after the
+ * header lines in header.
+ */
+static void write_baseline(const string &path, const string &header,
+						   const map<pair<string, string>, Sample> &total,
+						   int first, int last) {
+	ofstream fout(path);
+
+	fout << header << "# solver,mode,metric,value (sums of the medians over "
+		 << "public_tests, made by bench/perfcheck --update)\n";
+	for (auto &[key, sum] : total)
+		for (int m = first; m < last; ++m)
+			if (sum[m] >= 0)
+				fout << key.first << ',' << key.second << ',' << METRICS[m]
+					 << ',' << fixed << setprecision(m < INSTRUCTIONS ? 6 : 0)
+					 << sum[m] << '\n';
+	cerr << "baseline written to " << path << '\n';
+}
+
+int main(int argc, char *argv[]) {
+	int runs = 3;
+	double threshold = 15;
+	string baseline_path = "bench/perf_baseline.csv", bin = "bench/opt";
+	string local_path = "bench/perf_local.csv";
+	string modes;
+	bool update = false;
+
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+
+		if (arg == "--runs" && i + 1 < argc) {
+			runs = max(1, atoi(argv[++i]));
+		} else if (arg == "--threshold" && i + 1 < argc) {
+			threshold = atof(argv[++i]);
+		} else if (arg == "--baseline" && i + 1 < argc) {
+			baseline_path = argv[++i];
+		} else if (arg == "--local" && i + 1 < argc) {
+			local_path = argv[++i];
+		} else if (arg == "--bin" && i + 1 < argc) {
+			bin = argv[++i];
+		} else if (arg == "--modes" && i + 1 < argc) {
+			modes = argv[++i];
+		} else if (arg == "--update") {
+			update = true;
+		} else {
+			cerr << "usage: " << argv[0] << " [--runs N] [--threshold PCT]"
+				 << " [--baseline FILE] [--local FILE] [--bin DIR]"
+				 << " [--modes LIST] [--update]\n";
+			return 2;
+		}
+	}
+
+	// Whether a mode was asked for
+	auto selected = [&](const Mode &mode) {
+		string list = "," + modes + ",";
+
+		return modes.empty() ||
+			   list.find("," + string(mode.name) + ",") != string::npos;
+	};
+
+	char tmpl[] = "/tmp/perfcheck.XXXXXX";
+	if (!mkdtemp(tmpl)) {
+		perror("mkdtemp");
+		return 2;
+	}
+	string work = tmpl, store = work + "/store";
+	mkdir(store.c_str(), 0755);
+	char cwd[PATH_MAX];
+	if (!getcwd(cwd, sizeof(cwd))) {
+		perror("getcwd");
+		return 2;
+	}
+	if (bin[0] != '/')
+		bin = string(cwd) + "/" + bin;
+
+	// The recursive DFS of ferate and magazin needs a deep stack
+	struct rlimit stack = {RLIM_INFINITY, RLIM_INFINITY};
+	setrlimit(RLIMIT_STACK, &stack);
+
+	bool failed = false, counters = true;
+	// total[{solver, mode}][metric] = sum of the medians over the tests
+	map<pair<string, string>, Sample> total;
+
+	for (auto &solver : SOLVERS) {
+		string problem = solver.problem;
+		string dir = "public_tests/" + problem;
+		string binary = bin + "/" + solver.binary;
+
+		for (auto &mode : MODES) {
+			if (!strstr(mode.binaries, solver.binary) || !selected(mode))
+				continue;
+
+			vector<pair<string, string>> env(mode.env.begin(),
+											 mode.env.end());
+			if (mode.dir)
+				env.push_back({mode.dir, store});
+
+			Sample &sum = total[{problem, mode.name}];
+			sum.fill(0);
+
+			for (auto &name : inputs(dir + "/input")) {
+				string test = name.substr(0, name.size() - 3);
+				vector<Sample> samples;
+
+				if (!copy_file(dir + "/input/" + name, work + "/" + problem +
+							   ".in")) {
+					cerr << "cannot copy " << name << '\n';
+					return 2;
+				}
+
+				// A hit needs what the first run leaves in the directory
+				if (mode.dir) {
+					empty_dir(store);
+					if (mode.hit)
+						run_once(binary, work, env);
+				}
+
+				for (int run = 0; run < runs; ++run) {
+					if (mode.dir && !mode.hit)
+						empty_dir(store);
+
+					auto sample = run_once(binary, work, env);
+
+					if (!sample) {
+						cerr << "FAIL " << test << " (" << mode.name << "): "
+							 << solver.binary << " crashed\n";
+						failed = true;
+						break;
+					}
+					samples.push_back(*sample);
+				}
+				if ((int)samples.size() < runs)
+					continue;
+
+				if (tokens(work + "/" + problem + ".out") !=
+					tokens(dir + "/ref/" + test + ".ref")) {
+					cerr << "FAIL " << test << " (" << mode.name
+						 << "): wrong answer\n";
+					failed = true;
+				}
+
+				// Adds the median of every metric
+				for (int m = 0; m < NMETRICS; ++m) {
+					vector<double> values;
+
+					for (auto &sample : samples)
+						values.push_back(sample[m]);
+					nth_element(values.begin(), values.begin() + runs / 2,
+								values.end());
+
+					if (values[runs / 2] < 0)
+						sum[m] = -1;
+					else if (sum[m] >= 0)
+						sum[m] += values[runs / 2];
+				}
+			}
+
+			if (sum[INSTRUCTIONS] < 0)
+				counters = false;
+		}
+	}
+	for (auto &solver : SOLVERS) {
+		unlink((work + "/" + solver.problem + ".in").c_str());
+		unlink((work + "/" + solver.problem + ".out").c_str());
+	}
+	empty_dir(store);
+	rmdir(store.c_str());
+	rmdir(work.c_str());
+
+	if (!counters)
+		cerr << "perf_event_open not available, measuring times only\n";
+
+	// The counters are only written where they were measured, so that a
+	// machine without them keeps the checked-in ones
+	if (update) {
+		write_baseline(local_path, "# host " + host_name() + "\n", total,
+					   WALL, INSTRUCTIONS);
+		if (counters)
+			write_baseline(baseline_path, "", total, INSTRUCTIONS, NMETRICS);
+		else
+			cerr << baseline_path << " left as it is, without counters\n";
+		return failed;
+	}
+
+	// The checked-in counters, and the times of this host
+	map<Key, double> baseline;
+	for (auto &[key, value] : read_baseline(baseline_path))
+		if (key[2] != METRICS[WALL] && key[2] != METRICS[CPU])
+			baseline[key] = value;
+	for (auto &[key, value] : read_baseline(local_path))
+		if (key[2] == METRICS[WALL] || key[2] == METRICS[CPU])
+			baseline[key] = value;
+	bool same_host = baseline_host(local_path) == host_name();
+	if (!same_host)
+		cerr << "no times of this host in " << local_path
+			 << ", the times are advisory (make perfcheck UPDATE=1 writes "
+			 << "them)\n";
+	if (baseline.empty())
+		cerr << "no baseline, nothing to compare\n";
+
+	printf("%-14s %-14s %-14s %16s %16s %9s\n", "solver", "mode", "metric",
+		   "baseline", "current", "change");
+	for (auto &[key, sum] : total) {
+		auto &[problem, mode] = key;
+		// Instructions are far less noisy than time, so they decide
+		// whenever both sides have them; the CPU time of another host
+		// decides nothing
+		int gate = baseline.count({problem, mode, "instructions"}) &&
+				   sum[INSTRUCTIONS] >= 0 ? INSTRUCTIONS :
+				   same_host ? CPU : -1;
+
+		for (int m = 0; m < NMETRICS; ++m) {
+			auto it = baseline.find({problem, mode, METRICS[m]});
+
+			if (sum[m] < 0 || it == baseline.end() || it->second <= 0)
+				continue;
+
+			double change = 100 * (sum[m] / it->second - 1);
+			bool slower = m == gate && change > threshold;
+
+			printf("%-14s %-14s %-14s %16.6g %16.6g %+8.1f%%%s\n",
+				   problem.c_str(), mode.c_str(), METRICS[m], it->second,
+				   sum[m], change, slower ? "  SLOWER" : "");
+			failed |= slower;
+		}
+	}
+
+	return failed;
+}
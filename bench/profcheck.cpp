@@ -0,0 +1,285 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+// Brute-force check of the teleportation profile (AP_TELEPORT_PROFILE=1).
+//
+// Usage: profcheck [options]
+//
+//   --binary FILE     solver to check (default ./p3)
+//   --random N        random maps checked after public_tests (default 300)
+//   --seed S          seed of the random maps (default 1)
+//   --max-work W      skips the tests whose brute force would go through
+//                     more than W states (default 10^8)
+//
+// The solver is run in profile mode on every input of
+// public_tests/teleportare/input and on small random maps, and each of its
+// "t arrival" lines is checked against a forward Dijkstra that leaves room 1
+// at time t, one for every t modulo the lcm of the periods. The exit status
+// is 1 if a line differs (or is missing), 2 if the check could not run.
+
+#include <bits/stdc++.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct Arc {
+	int to, w;
+	bool portal;
+};
+
+struct Map {
+	int n = 0, lcm = 1;
+	// arcs[u] = the corridors and portals of room u, both ways
+	vector<vector<Arc>> arcs;
+};
+
+/**
+ * @brief Reads a map in the format of teleportare.in.
+ *
+ * @return false if the file cannot be read
+ */
+static bool read_map(const string &path, Map &map) {
+	ifstream fin(path);
+	int m, k;
+
+	if (!(fin >> map.n >> m >> k))
+		return false;
+
+	map.arcs.assign(map.n + 1, {});
+	map.lcm = 1;
+	for (int i = 0, x, y, w; i < m + k; ++i) {
+		fin >> x >> y >> w;
+		map.arcs[x].push_back({y, w, i >= m});
+		map.arcs[y].push_back({x, w, i >= m});
+		if (i >= m)
+			map.lcm = map.lcm / __gcd(map.lcm, w) * w;
+	}
+
+	return (bool)fin;
+}
+
+/**
+ * @brief
+ * Time: O((n + m + k) * lcm * log)
+ *
+ * Forward Dijkstra over the (room, time % lcm) states, in absolute times,
+ * from room 1 at time departure: a corridor of cost w takes w, a portal of
+ * period p takes 1 and may only be taken at a multiple of p.
+ *
+ * @return the time of arrival at room n, or -1
+ */
+static long long arrival(const Map &map, long long departure) {
+	const long long INF = LLONG_MAX;
+	vector<long long> best((size_t)(map.n + 1) * map.lcm, INF);
+	priority_queue<pair<long long, int>, vector<pair<long long, int>>,
+				   greater<pair<long long, int>>> pq;
+
+	best[(size_t)1 * map.lcm + departure % map.lcm] = departure;
+	pq.push({departure, 1});
+
+	while (!pq.empty()) {
+		auto [time, u] = pq.top();
+		pq.pop();
+
+		if (u == map.n)
+			return time;
+		if (best[(size_t)u * map.lcm + time % map.lcm] < time)
+			continue;
+
+		for (auto &arc : map.arcs[u]) {
+			if (arc.portal && time % arc.w)
+				continue;
+
+			long long next = time + (arc.portal ? 1 : arc.w);
+			long long &state = best[(size_t)arc.to * map.lcm +
+									next % map.lcm];
+			if (state <= next)
+				continue;
+			state = next;
+			pq.push({next, arc.to});
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * @brief Runs binary in dir, in profile mode.
+ *
+ * @return whether it exited cleanly
+ */
+static bool run_profile(const string &binary, const string &dir) {
+	pid_t pid = fork();
+
+	if (pid < 0) {
+		perror("fork");
+		exit(2);
+	}
+	if (pid == 0) {
+		if (chdir(dir.c_str()) < 0)
+			_exit(127);
+		setenv("AP_TELEPORT_PROFILE", "1", 1);
+		execl(binary.c_str(), binary.c_str(), (char *)nullptr);
+		_exit(127);
+	}
+
+	int status;
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) && !WEXITSTATUS(status);
+}
+
+/**
+ * @brief Solves the map in dir/teleportare.in with the solver and checks
+ * every line of its profile.
+ *
+ * @return the number of wrong or missing lines, or -1 if it crashed
+ */
+static int check(const string &binary, const string &dir, const Map &map) {
+	if (!run_profile(binary, dir))
+		return -1;
+
+	ifstream fin(dir + "/teleportare.out");
+	int wrong = 0;
+
+	for (int t = 0; t < map.lcm; ++t) {
+		long long time, got;
+
+		if (!(fin >> time >> got) || time != t || got != arrival(map, t))
+			++wrong;
+	}
+
+	return wrong;
+}
+
+// Writes a random map of at most rooms rooms to path
+static void random_map(mt19937_64 &rng, int rooms, const string &path) {
+	static const int PERIODS[] = {1, 2, 3, 4, 5, 6, 8, 12};
+	auto pick = [&](int low, int high) {
+		return (int)(rng() % (high - low + 1)) + low;
+	};
+	int n = pick(1, rooms), m = pick(0, 3 * n), k = pick(0, 4);
+	ofstream fout(path);
+
+	fout << n << ' ' << m << ' ' << k << '\n';
+	for (int i = 0; i < m; ++i)
+		fout << pick(1, n) << ' ' << pick(1, n) << ' ' << pick(1, 9) << '\n';
+	for (int i = 0; i < k; ++i)
+		fout << pick(1, n) << ' ' << pick(1, n) << ' '
+			 << PERIODS[pick(0, 7)] << '\n';
+}
+
+// Names of the .in files in dir, sorted
+static vector<string> inputs(const string &dir) {
+	vector<string> names;
+	DIR *d = opendir(dir.c_str());
+
+	if (!d)
+		return names;
+	while (auto *entry = readdir(d)) {
+		string name = entry->d_name;
+
+		if (name.size() > 3 && name.substr(name.size() - 3) == ".in")
+			names.push_back(name);
+	}
+	closedir(d);
+	sort(names.begin(), names.end());
+
+	return names;
+}
+
+int main(int argc, char *argv[]) {
+	string binary = "./p3";
+	int randoms = 300;
+	unsigned long long seed = 1;
+	double max_work = 1e8;
+
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+
+		if (arg == "--binary" && i + 1 < argc) {
+			binary = argv[++i];
+		} else if (arg == "--random" && i + 1 < argc) {
+			randoms = max(0, atoi(argv[++i]));
+		} else if (arg == "--seed" && i + 1 < argc) {
+			seed = strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "--max-work" && i + 1 < argc) {
+			max_work = atof(argv[++i]);
+		} else {
+			cerr << "usage: " << argv[0] << " [--binary FILE] [--random N]"
+				 << " [--seed S] [--max-work W]\n";
+			return 2;
+		}
+	}
+
+	char tmpl[] = "/tmp/profcheck.XXXXXX";
+	if (!mkdtemp(tmpl)) {
+		perror("mkdtemp");
+		return 2;
+	}
+	string work = tmpl, in = work + "/teleportare.in";
+	if (binary[0] != '/') {
+		char cwd[PATH_MAX];
+
+		if (!getcwd(cwd, sizeof(cwd))) {
+			perror("getcwd");
+			return 2;
+		}
+		binary = string(cwd) + "/" + binary;
+	}
+
+	bool failed = false;
+	int checked = 0, skipped = 0;
+	auto report = [&](const string &test, int wrong) {
+		if (wrong < 0)
+			cerr << "FAIL " << test << ": crashed\n";
+		else if (wrong)
+			cerr << "FAIL " << test << ": " << wrong << " wrong lines\n";
+		failed |= wrong != 0;
+		++checked;
+	};
+
+	string dir = "public_tests/teleportare/input";
+	for (auto &name : inputs(dir)) {
+		Map map;
+		ifstream fin(dir + "/" + name, ios::binary);
+		ofstream fout(in, ios::binary);
+
+		fout << fin.rdbuf();
+		fout.close();
+		if (!read_map(in, map)) {
+			cerr << "cannot read " << name << '\n';
+			return 2;
+		}
+
+		// The brute force runs one search per departure time
+		size_t arcs = 0;
+		for (auto &list : map.arcs)
+			arcs += list.size();
+		if ((double)map.lcm * map.lcm * (map.n + arcs) > max_work) {
+			++skipped;
+			continue;
+		}
+
+		report(name, check(binary, work, map));
+	}
+
+	mt19937_64 rng(seed);
+	for (int i = 1; i <= randoms; ++i) {
+		Map map;
+
+		random_map(rng, 12, in);
+		read_map(in, map);
+		report("random " + to_string(i), check(binary, work, map));
+	}
+
+	unlink(in.c_str());
+	unlink((work + "/teleportare.out").c_str());
+	rmdir(work.c_str());
+
+	cerr << checked << " maps checked, " << skipped
+		 << " skipped (--max-work)\n";
+	return failed;
+}
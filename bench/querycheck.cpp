@@ -0,0 +1,404 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+// Brute-force check of the queries listed in the teleportation input.
+//
+// Usage: querycheck [options]
+//
+//   --binary FILE     solver to check (default ./p3)
+//   --random N        random maps checked after public_tests (default 300)
+//   --queries Q       queries listed on every map (default 20)
+//   --seed S          seed of the maps and of the queries (default 1)
+//   --max-work W      skips the tests whose brute force, or whose overlay,
+//                     would go through more than W states (default 10^7)
+//
+// Random queries are listed after the portals of every input of
+// public_tests/teleportare/input and of small random maps, and the solver
+// answers them in every engine (see ENGINES): the usual Dijkstra, the rows,
+// the overlay (AP_TELEPORT_OVERLAY=always) and the overlay loaded from the
+// snapshot of the map, written by a first run with other queries. Each
+// answer is checked against a forward Dijkstra from the source of its query.
+// The exit status is 1 if an answer differs (or is missing), 2 if the check
+// could not run.
+
+#include <bits/stdc++.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct Arc {
+	int to, w;
+	bool portal;
+};
+
+struct Map {
+	int n = 0, lcm = 1;
+	// arcs[u] = the corridors and portals of room u, both ways
+	vector<vector<Arc>> arcs;
+	// text = the corridors and portals, as in teleportare.in
+	string text;
+};
+
+// (source, target, departure)
+using Query = array<int, 3>;
+
+// A way of answering the queries: the environment it sets and, for the
+// snapshot, whether a first run with other queries writes the overlay
+struct Engine {
+	const char *name;
+	vector<pair<const char *, const char *>> env;
+	bool snapshot;
+};
+
+static const Engine ENGINES[] = {
+	{"dijkstra", {}, false},
+	{"rows", {{"AP_TELEPORT_ENGINE", "rows"}}, false},
+	{"overlay", {{"AP_TELEPORT_OVERLAY", "always"}}, false},
+	{"snapshot", {{"AP_TELEPORT_OVERLAY", "always"}}, true},
+};
+
+/**
+ * @brief Reads a map in the format of teleportare.in (without queries).
+ *
+ * @return false if the file cannot be read
+ */
+static bool read_map(const string &path, Map &map) {
+	ifstream fin(path);
+	int m, k;
+
+	if (!(fin >> map.n >> m >> k))
+		return false;
+
+	stringstream text;
+	text << map.n << ' ' << m << ' ' << k << '\n';
+	map.arcs.assign(map.n + 1, {});
+	map.lcm = 1;
+	for (int i = 0, x, y, w; i < m + k; ++i) {
+		fin >> x >> y >> w;
+		text << x << ' ' << y << ' ' << w << '\n';
+		map.arcs[x].push_back({y, w, i >= m});
+		map.arcs[y].push_back({x, w, i >= m});
+		if (i >= m)
+			map.lcm = map.lcm / __gcd(map.lcm, w) * w;
+	}
+	map.text = text.str();
+
+	return (bool)fin;
+}
+
+/**
+ * @brief
+ * Time: O((n + m + k) * lcm * log)
+ *
+ * Forward Dijkstra over the (room, time % lcm) states, in absolute times,
+ * from source at time departure: a corridor of cost w takes w, a portal of
+ * period p takes 1 and may only be taken at a multiple of p.
+ *
+ * @return the minimum cost to reach target, or -1
+ */
+static long long cost(const Map &map, const Query &query) {
+	auto [source, target, departure] = query;
+	const long long INF = LLONG_MAX;
+	vector<long long> best((size_t)(map.n + 1) * map.lcm, INF);
+	priority_queue<pair<long long, int>, vector<pair<long long, int>>,
+				   greater<pair<long long, int>>> pq;
+
+	best[(size_t)source * map.lcm + departure % map.lcm] = departure;
+	pq.push({departure, source});
+
+	while (!pq.empty()) {
+		auto [time, u] = pq.top();
+		pq.pop();
+
+		if (u == target)
+			return time - departure;
+		if (best[(size_t)u * map.lcm + time % map.lcm] < time)
+			continue;
+
+		for (auto &arc : map.arcs[u]) {
+			if (arc.portal && time % arc.w)
+				continue;
+
+			long long next = time + (arc.portal ? 1 : arc.w);
+			long long &state = best[(size_t)arc.to * map.lcm +
+									next % map.lcm];
+			if (state <= next)
+				continue;
+			state = next;
+			pq.push({next, arc.to});
+		}
+	}
+
+	return -1;
+}
+
+// Writes the map and the queries to dir/teleportare.in
+static void write_input(const string &dir, const Map &map,
+						const vector<Query> &queries) {
+	ofstream fout(dir + "/teleportare.in");
+
+	fout << map.text << queries.size() << '\n';
+	for (auto &[source, target, departure] : queries)
+		fout << source << ' ' << target << ' ' << departure << '\n';
+}
+
+/**
+ * @brief Runs binary in dir, with the environment of engine and, if store
+ * is not empty, with AP_SNAPSHOT_DIR = store.
+ *
+ * @return whether it exited cleanly
+ */
+static bool run(const string &binary, const string &dir, const Engine &engine,
+				const string &store) {
+	pid_t pid = fork();
+
+	if (pid < 0) {
+		perror("fork");
+		exit(2);
+	}
+	if (pid == 0) {
+		if (chdir(dir.c_str()) < 0)
+			_exit(127);
+		for (auto &[name, value] : engine.env)
+			setenv(name, value, 1);
+		if (!store.empty())
+			setenv("AP_SNAPSHOT_DIR", store.c_str(), 1);
+		execl(binary.c_str(), binary.c_str(), (char *)nullptr);
+		_exit(127);
+	}
+
+	int status;
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) && !WEXITSTATUS(status);
+}
+
+// Removes the files in dir (the snapshots)
+static void empty_dir(const string &dir) {
+	DIR *d = opendir(dir.c_str());
+
+	if (!d)
+		return;
+	while (auto *entry = readdir(d))
+		if (entry->d_name[0] != '.')
+			unlink((dir + "/" + entry->d_name).c_str());
+	closedir(d);
+}
+
+/**
+ * @brief Answers the queries on the map with the solver, in one engine, and
+ * checks every answer against expected.
+ *
+ * @return the number of wrong or missing answers, or -1 if it crashed
+ */
+static int check(const string &binary, const string &dir, const Map &map,
+				 const Engine &engine, const vector<Query> &queries,
+				 const vector<Query> &others,
+				 const vector<long long> &expected) {
+	string store = engine.snapshot ? dir + "/store" : "";
+
+	// The first run writes the overlay of the map, for other queries
+	if (engine.snapshot) {
+		empty_dir(store);
+		write_input(dir, map, others);
+		if (!run(binary, dir, engine, store))
+			return -1;
+	}
+
+	write_input(dir, map, queries);
+	if (!run(binary, dir, engine, store))
+		return -1;
+
+	ifstream fin(dir + "/teleportare.out");
+	int wrong = 0;
+
+	for (auto answer : expected) {
+		long long got;
+
+		if (!(fin >> got) || got != answer)
+			++wrong;
+	}
+
+	return wrong;
+}
+
+// Writes a random map of at most rooms rooms to path
+static void random_map(mt19937_64 &rng, int rooms, const string &path) {
+	static const int PERIODS[] = {1, 2, 3, 4, 5, 6, 8, 12};
+	auto pick = [&](int low, int high) {
+		return (int)(rng() % (high - low + 1)) + low;
+	};
+	int n = pick(1, rooms), m = pick(0, 3 * n), k = pick(0, 4);
+	ofstream fout(path);
+
+	fout << n << ' ' << m << ' ' << k << '\n';
+	for (int i = 0; i < m; ++i)
+		fout << pick(1, n) << ' ' << pick(1, n) << ' ' << pick(1, 9) << '\n';
+	for (int i = 0; i < k; ++i)
+		fout << pick(1, n) << ' ' << pick(1, n) << ' '
+			 << PERIODS[pick(0, 7)] << '\n';
+}
+
+// count random queries on the map: half of them between any rooms, the
+// other half between portal endpoints (and 1 and n)
+static vector<Query> random_queries(mt19937_64 &rng, const Map &map,
+									int count) {
+	vector<int> ends = {1, map.n};
+	for (int u = 1; u <= map.n; ++u)
+		for (auto &arc : map.arcs[u])
+			if (arc.portal)
+				ends.push_back(u);
+
+	vector<Query> queries;
+	for (int i = 0; i < count; ++i) {
+		int source, target;
+
+		if (i % 2) {
+			source = ends[rng() % ends.size()];
+			target = ends[rng() % ends.size()];
+		} else {
+			source = rng() % map.n + 1;
+			target = rng() % map.n + 1;
+		}
+		queries.push_back({source, target, (int)(rng() % (3 * map.lcm))});
+	}
+
+	return queries;
+}
+
+// Names of the .in files in dir, sorted
+static vector<string> inputs(const string &dir) {
+	vector<string> names;
+	DIR *d = opendir(dir.c_str());
+
+	if (!d)
+		return names;
+	while (auto *entry = readdir(d)) {
+		string name = entry->d_name;
+
+		if (name.size() > 3 && name.substr(name.size() - 3) == ".in")
+			names.push_back(name);
+	}
+	closedir(d);
+	sort(names.begin(), names.end());
+
+	return names;
+}
+
+int main(int argc, char *argv[]) {
+	string binary = "./p3";
+	int randoms = 300, count = 20;
+	unsigned long long seed = 1;
+	double max_work = 1e7;
+
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+
+		if (arg == "--binary" && i + 1 < argc) {
+			binary = argv[++i];
+		} else if (arg == "--random" && i + 1 < argc) {
+			randoms = max(0, atoi(argv[++i]));
+		} else if (arg == "--queries" && i + 1 < argc) {
+			count = max(1, atoi(argv[++i]));
+		} else if (arg == "--seed" && i + 1 < argc) {
+			seed = strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "--max-work" && i + 1 < argc) {
+			max_work = atof(argv[++i]);
+		} else {
+			cerr << "usage: " << argv[0] << " [--binary FILE] [--random N]"
+				 << " [--queries Q] [--seed S] [--max-work W]\n";
+			return 2;
+		}
+	}
+
+	char tmpl[] = "/tmp/querycheck.XXXXXX";
+	if (!mkdtemp(tmpl)) {
+		perror("mkdtemp");
+		return 2;
+	}
+	string work = tmpl, in = work + "/teleportare.in";
+	mkdir((work + "/store").c_str(), 0755);
+	if (binary[0] != '/') {
+		char cwd[PATH_MAX];
+
+		if (!getcwd(cwd, sizeof(cwd))) {
+			perror("getcwd");
+			return 2;
+		}
+		binary = string(cwd) + "/" + binary;
+	}
+
+	mt19937_64 rng(seed);
+	bool failed = false;
+	int checked = 0, skipped = 0;
+
+	// Answers random queries on the map in every engine
+	auto check_map = [&](const string &test, const Map &map) {
+		auto queries = random_queries(rng, map, count);
+		auto others = random_queries(rng, map, count);
+		vector<long long> expected;
+
+		for (auto &query : queries)
+			expected.push_back(cost(map, query));
+
+		for (auto &engine : ENGINES) {
+			int wrong = check(binary, work, map, engine, queries, others,
+							  expected);
+
+			if (wrong < 0)
+				cerr << "FAIL " << test << " (" << engine.name
+					 << "): crashed\n";
+			else if (wrong)
+				cerr << "FAIL " << test << " (" << engine.name << "): "
+					 << wrong << " wrong answers\n";
+			failed |= wrong != 0;
+		}
+		++checked;
+	};
+
+	string dir = "public_tests/teleportare/input";
+	for (auto &name : inputs(dir)) {
+		Map map;
+
+		if (!read_map(dir + "/" + name, map)) {
+			cerr << "cannot read " << name << '\n';
+			return 2;
+		}
+
+		// The brute force runs one search per query, and the overlay one
+		// per portal endpoint
+		size_t arcs = 0, ends = 2;
+		for (auto &list : map.arcs) {
+			arcs += list.size();
+			for (auto &arc : list)
+				ends += arc.portal;
+		}
+		if ((double)max(count, (int)ends) * map.lcm * (map.n + arcs) >
+			max_work) {
+			++skipped;
+			continue;
+		}
+
+		check_map(name, map);
+	}
+
+	for (int i = 1; i <= randoms; ++i) {
+		Map map;
+
+		random_map(rng, 12, in);
+		read_map(in, map);
+		check_map("random " + to_string(i), map);
+	}
+
+	empty_dir(work + "/store");
+	rmdir((work + "/store").c_str());
+	unlink(in.c_str());
+	unlink((work + "/teleportare.out").c_str());
+	rmdir(work.c_str());
+
+	cerr << checked << " maps checked, " << skipped
+		 << " skipped (--max-work)\n";
+	return failed;
+}
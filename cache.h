@@ -0,0 +1,294 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <bits/stdc++.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * 64-bit hash of a parsed input, fed while it is read.
+ *
+ * The numbers that must come in a fixed order (the sizes, the data sets of
+ * supercomputer, the parents and queries of magazin) go through add(), which
+ * is XXH64 over their 8-byte little-endian values. The arcs, whose order
+ * does not change any answer, go through item(): every arc is hashed on its
+ * own and the hashes are summed, so two inputs that only list the arcs in
+ * another order (or with other whitespace) get the same digest.
+ */
+class Hasher {
+ public:
+	// A disabled hasher ignores everything, so it costs next to nothing
+	explicit Hasher(bool enabled = false) : enabled(enabled) {}
+
+	// Adds a number, in order
+	void add(unsigned long long x) {
+		if (!enabled)
+			return;
+
+		lane[lanes++] = x;
+		if (lanes == 4) {
+			for (int i = 0; i < 4; ++i)
+				acc[i] = round(acc[i], lane[i]);
+			lanes = 0;
+			stripes = true;
+		}
+		length += 8;
+	}
+
+	// Adds an arc (or any record whose position does not matter)
+	void item(unsigned long long a, unsigned long long b,
+			  unsigned long long c = 0, unsigned long long d = 0) {
+		if (!enabled)
+			return;
+
+		unsigned long long h = P5;
+		h = rotl(h ^ round(0, a), 27) * P1 + P4;
+		h = rotl(h ^ round(0, b), 27) * P1 + P4;
+		h = rotl(h ^ round(0, c), 27) * P1 + P4;
+		h = rotl(h ^ round(0, d), 27) * P1 + P4;
+		items += avalanche(h);
+		++count;
+	}
+
+	// Digest of everything added so far, the items included
+	unsigned long long digest() const {
+		Hasher last = *this;
+
+		last.add(last.items);
+		last.add(last.count);
+		return last.finish();
+	}
+
+ private:
+	static constexpr unsigned long long P1 = 0x9E3779B185EBCA87ULL;
+	static constexpr unsigned long long P2 = 0xC2B2AE3D27D4EB4FULL;
+	static constexpr unsigned long long P3 = 0x165667B19E3779F9ULL;
+	static constexpr unsigned long long P4 = 0x85EBCA77C2B2AE63ULL;
+	static constexpr unsigned long long P5 = 0x27D4EB2F165667C5ULL;
+
+	bool enabled;
+	// acc = the 4 accumulators, lane = the numbers of the current stripe
+	unsigned long long acc[4] = {P1 + P2, P2, 0, 0ULL - P1};
+	unsigned long long lane[4];
+	int lanes = 0;
+	bool stripes = false;
+	unsigned long long length = 0;
+	// items = sum of the hashes of the items, count = their number
+	unsigned long long items = 0, count = 0;
+
+	static unsigned long long rotl(unsigned long long x, int r) {
+		return (x << r) | (x >> (64 - r));
+	}
+
+	static unsigned long long round(unsigned long long acc,
+									unsigned long long x) {
+		return rotl(acc + x * P2, 31) * P1;
+	}
+
+	static unsigned long long merge(unsigned long long h,
+									unsigned long long x) {
+		return (h ^ round(0, x)) * P1 + P4;
+	}
+
+	static unsigned long long avalanche(unsigned long long h) {
+		h ^= h >> 33;
+		h *= P2;
+		h ^= h >> 29;
+		h *= P3;
+		return h ^ (h >> 32);
+	}
+
+	unsigned long long finish() const {
+		unsigned long long h;
+
+		if (stripes) {
+			h = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) +
+				rotl(acc[3], 18);
+			for (int i = 0; i < 4; ++i)
+				h = merge(h, acc[i]);
+		} else {
+			h = P5;
+		}
+		h += length;
+
+		for (int i = 0; i < lanes; ++i)
+			h = rotl(h ^ round(0, lane[i]), 27) * P1 + P4;
+
+		return avalanche(h);
+	}
+};
+
+/**
+ * On-disk cache of output files, keyed by the digest of the input.
+ *
+ * Off unless AP_CACHE_DIR names a directory (created if missing). The output
+ * of a solve is kept as <dir>/<problem>-<digest>.res; when the same input
+ * comes again, the file is copied back and the algorithm is not run.
+ *
+ * The entries are evicted least recently used first (their modification
+ * time is bumped on every hit) whenever they take more than AP_CACHE_MAX
+ * bytes (64 MiB by default). The hits, misses and evictions of all the runs
+ * are kept in <dir>/stats, as "hits 3 misses 1 evictions 0".
+ */
+class ResultCache {
+ public:
+	explicit ResultCache(const char *problem) : problem(problem) {
+		const char *env = getenv("AP_CACHE_DIR");
+		if (!env || !*env)
+			return;
+
+		dir = env;
+		mkdir(dir.c_str(), 0755);
+
+		const char *max = getenv("AP_CACHE_MAX");
+		if (max && *max)
+			max_bytes = atoll(max);
+	}
+
+	bool enabled() const {
+		return !dir.empty();
+	}
+
+	/**
+	 * @brief Copies the cached output of an input to output, on a hit.
+	 *
+	 * @param key the digest of the input
+	 * @param output the output file of the solver
+	 * @return whether the input was found
+	 */
+	bool load(unsigned long long key, const char *output) {
+		if (!enabled())
+			return false;
+
+		std::string entry = path(key);
+		bool hit = copy(entry, output);
+
+		if (hit)
+			utimensat(AT_FDCWD, entry.c_str(), nullptr, 0);
+		count(hit ? 1 : 0, hit ? 0 : 1, 0);
+
+		return hit;
+	}
+
+	/**
+	 * @brief Caches output as the answer for an input, then evicts the
+	 * oldest entries if the cache got too large.
+	 *
+	 * @param key the digest of the input
+	 * @param output the output file of the solver
+	 */
+	void store(unsigned long long key, const char *output) {
+		if (!enabled())
+			return;
+
+		// Written aside and renamed, so that no run sees half an entry
+		std::string entry = path(key);
+		std::string temp = entry + ".tmp" + std::to_string(getpid());
+		if (!copy(output, temp) || rename(temp.c_str(), entry.c_str())) {
+			unlink(temp.c_str());
+			return;
+		}
+
+		count(0, 0, evict());
+	}
+
+ private:
+	const char *problem;
+	std::string dir;
+	long long max_bytes = 64LL << 20;
+
+	std::string path(unsigned long long key) const {
+		char name[64];
+
+		snprintf(name, sizeof(name), "/%s-%016llx.res", problem, key);
+		return dir + name;
+	}
+
+	static bool copy(const std::string &from, const std::string &to) {
+		std::ifstream fin(from, std::ios::binary);
+		if (!fin)
+			return false;
+
+		// Copying an empty file sets failbit on fout, so it is skipped (the
+		// output of a solver with nothing to print is empty)
+		std::ofstream fout(to, std::ios::binary);
+		if (fin.peek() != std::ifstream::traits_type::eof())
+			fout << fin.rdbuf();
+		return (bool)fout;
+	}
+
+	/**
+	 * @brief
+	 * Time: O(e log e), e = number of entries
+	 *
+	 * Removes the least recently used entries until the others fit.
+	 *
+	 * @return the number of entries removed
+	 */
+	int evict() {
+		// (last use, size, name) of every entry
+		std::vector<std::tuple<long long, long long, std::string>> entries;
+		long long total = 0;
+
+		DIR *d = opendir(dir.c_str());
+		if (!d)
+			return 0;
+		while (auto *entry = readdir(d)) {
+			std::string name = entry->d_name;
+			struct stat st;
+
+			if (name.size() < 4 || name.substr(name.size() - 4) != ".res" ||
+				stat((dir + "/" + name).c_str(), &st))
+				continue;
+			entries.emplace_back(st.st_mtim.tv_sec * 1000000000LL +
+								 st.st_mtim.tv_nsec, st.st_size, name);
+			total += st.st_size;
+		}
+		closedir(d);
+
+		std::sort(entries.begin(), entries.end());
+		int evicted = 0;
+		for (auto &[used, size, name] : entries) {
+			if (total <= max_bytes)
+				break;
+			if (!unlink((dir + "/" + name).c_str())) {
+				total -= size;
+				++evicted;
+			}
+		}
+
+		return evicted;
+	}
+
+	// Adds to the counters in <dir>/stats, locked against other runs
+	void count(long long hits, long long misses, long long evictions) {
+		std::string file = dir + "/stats";
+		int fd = open(file.c_str(), O_RDWR | O_CREAT, 0644);
+		if (fd < 0)
+			return;
+		flock(fd, LOCK_EX);
+
+		char buf[128] = {};
+		long long old[3] = {0, 0, 0};
+		if (pread(fd, buf, sizeof(buf) - 1, 0) > 0)
+			sscanf(buf, "hits %lld misses %lld evictions %lld", &old[0],
+				   &old[1], &old[2]);
+
+		int len = snprintf(buf, sizeof(buf),
+						   "hits %lld misses %lld evictions %lld\n",
+						   old[0] + hits, old[1] + misses, old[2] + evictions);
+		if (pwrite(fd, buf, len, 0) == len && ftruncate(fd, len))
+			perror("ftruncate");
+
+		flock(fd, LOCK_UN);
+		close(fd);
+	}
+};
+
+#endif  // CACHE_H_
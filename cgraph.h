@@ -0,0 +1,489 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+#ifndef CGRAPH_H_
+#define CGRAPH_H_
+
+#include "graph.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CGRAPH_SSSE3 1
+#endif
+
+/**
+ * Adjacency lists with sorted neighbours, stored as gaps in the Stream VByte
+ * format: every group of 4 gaps has a control byte (2 bits per gap, the
+ * number of bytes minus 1) and the gaps themselves take 1 to 4 bytes each.
+ * The first gap of the list of u is the distance from u to its first
+ * neighbour, zigzag-encoded (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...), which
+ * keeps it short when the ids are local.
+ *
+ * The list of node u starts at bytes[base[u >> BLOCK_BITS] + offset[u]]:
+ *
+ *   degree   as a varint (7 bits per byte, 1 byte below 128)
+ *   weights  with as few bits per arc (4, 8, 16 or 32) as the largest
+ *            weight of the graph needs, if the graph is weighted
+ *   control  ceil(degree / 4) control bytes
+ *   gaps     1 to 4 bytes each
+ *
+ * Keeping the degree in the list spares a per-node array of arc indices,
+ * and keeping 64-bit positions only once per block saves 4 more bytes per
+ * node; so a node costs its 4-byte offset and (mostly) 1 byte of degree,
+ * and there is no limit on the number of arcs but that of the memory.
+ *
+ * A group of 4 gaps is decoded with a single shuffle on CPUs with SSSE3, one
+ * byte at a time otherwise. The lists are decoded one group at a time while
+ * they are traversed, so the graph is never decompressed as a whole.
+ */
+struct CompressedGraph {
+	// Iterates over the neighbours (ARCS = false) or the arcs (ARCS = true)
+	// of a node
+	template <bool ARCS>
+	class Iterator {
+	 public:
+		// The end of any list
+		Iterator() = default;
+
+		Iterator(const CompressedGraph *g, int u) : g(g) {
+			const uint8_t *list = g->bytes.data() + g->position(u);
+
+			left = read_degree(list);
+			weights = list;
+			ctrl = weights + g->weight_bytes(left);
+			data = ctrl + (left + 3) / 4;
+			if (left) {
+				load();
+				value = u + unzigzag(gaps[0]);
+			}
+		}
+
+		std::conditional_t<ARCS, Arc, int> operator*() const {
+			if constexpr (ARCS)
+				return Arc{value, g->weight(weights, index)};
+			else
+				return value;
+		}
+
+		Iterator &operator++() {
+			if (!--left)
+				return *this;
+			++index;
+			if (++pos == 4)
+				load();
+			else
+				value += gaps[pos];
+			return *this;
+		}
+
+		bool operator!=(const Iterator &other) const {
+			return left != other.left;
+		}
+
+	 private:
+		const CompressedGraph *g = nullptr;
+		// left = arcs not yet passed, index = current arc in the list
+		long long left = 0, index = 0;
+		// weights = the weights of the list, ctrl = next control byte,
+		// data = its gaps
+		const uint8_t *weights = nullptr, *ctrl = nullptr, *data = nullptr;
+		// gaps = current group, pos = current gap in it, value = neighbour
+		uint32_t gaps[4];
+		int pos = 0, value = 0;
+
+		void load() {
+			data = decode(*ctrl++, data, gaps);
+			pos = 0;
+			value += gaps[0];
+		}
+	};
+
+	template <bool ARCS>
+	struct Range {
+		const CompressedGraph *g;
+		int u;
+
+		Iterator<ARCS> begin() const {
+			return Iterator<ARCS>(g, u);
+		}
+		Iterator<ARCS> end() const {
+			return Iterator<ARCS>();
+		}
+	};
+
+	// Nodes per block of offsets
+	static constexpr int BLOCK_BITS = 8;
+
+	// n = number of nodes
+	int n = 0;
+	// base[b] = position in bytes of the first list of block b
+	// offset[u] = position of the list of u, from the start of its block
+	avector<long long> base;
+	avector<uint32_t> offset;
+	// bytes = the lists
+	avector<uint8_t> bytes;
+	// weight_bits = bits per weight, 0 if the graph is unweighted
+	int weight_bits = 0;
+
+	explicit CompressedGraph(Arena *arena)
+		: base(arena), offset(arena), bytes(arena) {}
+
+	// Whether the solvers should compress their lists (AP_COMPRESS is set
+	// and not "0")
+	static bool enabled() {
+		const char *env = getenv("AP_COMPRESS");
+
+		return env && strcmp(env, "0");
+	}
+
+	/**
+	 * @brief
+	 * Time: O(n + m log(max degree))
+	 * Space: O(n + m)
+	 *
+	 * Compresses the arcs (from[i], dest[i]), i = 0..m - 1, with weight[i]
+	 * attached if weight is not null, without building plain lists first:
+	 * the arcs are sorted by source in place (see sort_by_source()), then
+	 * every list is sorted by neighbour in place and encoded. Only a buffer
+	 * as large as the longest list is taken, from scratch.
+	 */
+	void build(int nodes, avector<int> &from, avector<int> &dest,
+			   avector<int> *weight, Arena *scratch) {
+		n = nodes;
+		size_t m = from.size();
+
+		int shift = 0;
+		while (shift + RADIX_BITS < 32 && n >> (shift + RADIX_BITS))
+			shift += RADIX_BITS;
+		sort_by_source(from, dest, weight, 0, m, shift);
+
+		// Picks the narrowest weight width
+		int max_weight = 0;
+		if (weight)
+			for (auto x : *weight)
+				max_weight = std::max(max_weight, x);
+		weight_bits = !weight || !m ? 0 : max_weight < 16 ? 4 :
+					  max_weight < 256 ? 8 : max_weight < 65536 ? 16 : 32;
+
+		// The lists are now back to back: the one of u ends where the
+		// sources stop being u
+		auto last = [&](int u, size_t first) {
+			while (first < m && from[first] == u)
+				++first;
+			return first;
+		};
+
+		// Sorts every list by neighbour and computes the sizes, through a
+		// buffer as large as the longest list
+		size_t max_degree = 0;
+		for (size_t first = 0; first < m;) {
+			size_t end = last(from[first], first);
+
+			max_degree = std::max(max_degree, end - first);
+			first = end;
+		}
+		avector<Arc> list(max_degree, scratch);
+
+		base.assign(((n + 1) >> BLOCK_BITS) + 1, 0);
+		offset.assign(n + 1, 0);
+		long long size = 0;
+		for (size_t u = 0, first = 0; u <= (size_t)n; ++u) {
+			size_t end = last(u, first), degree = end - first;
+
+			for (size_t i = 0; i < degree; ++i)
+				list[i] = {dest[first + i], weight ? (*weight)[first + i] : 0};
+			std::sort(list.begin(), list.begin() + degree,
+					  [](const Arc &a, const Arc &b) {
+				return a.to < b.to;
+			});
+			for (size_t i = 0; i < degree; ++i) {
+				dest[first + i] = list[i].to;
+				if (weight)
+					(*weight)[first + i] = list[i].w;
+			}
+
+			if (!(u & ((1 << BLOCK_BITS) - 1)))
+				base[u >> BLOCK_BITS] = size;
+			if (size - base[u >> BLOCK_BITS] > UINT32_MAX) {
+				std::cerr << "cgraph: block of more than 4 GiB\n";
+				abort();
+			}
+			offset[u] = size - base[u >> BLOCK_BITS];
+
+			size += degree_length(degree) + weight_bytes(degree) +
+					(degree + 3) / 4;
+			for (size_t e = first; e < end; ++e)
+				size += gap_length(gap(dest, u, first, e));
+			first = end;
+		}
+
+		// A shuffle always reads 16 bytes, weight() always reads 4
+		bytes.assign(size + 16, 0);
+
+		// Writes the lists
+		for (size_t u = 0, first = 0; u <= (size_t)n; ++u) {
+			size_t end = last(u, first), degree = end - first;
+			uint8_t *list = bytes.data() + position(u);
+
+			list = write_degree(list, degree);
+			if (weight_bits)
+				for (size_t i = 0; i < degree; ++i)
+					set_weight(list, i, (*weight)[first + i]);
+			uint8_t *ctrl = list + weight_bytes(degree);
+			uint8_t *data = ctrl + (degree + 3) / 4;
+
+			for (size_t i = 0; i < degree; ++i) {
+				uint32_t value = gap(dest, u, first, first + i);
+				int len = gap_length(value);
+
+				ctrl[i / 4] |= (len - 1) << (2 * (i % 4));
+				for (int b = 0; b < len; ++b)
+					*data++ = value >> (8 * b);
+			}
+			first = end;
+		}
+	}
+
+	// Neighbours of node u, in increasing order
+	Range<false> adj(int u) const {
+		return {this, u};
+	}
+
+	// Arcs going out of node u, in increasing order of destination
+	Range<true> arcs(int u) const {
+		return {this, u};
+	}
+
+	// Number of arcs going out of node u
+	long long degree(int u) const {
+		const uint8_t *list = bytes.data() + position(u);
+
+		return read_degree(list);
+	}
+
+	// Position in bytes of the list of node u
+	long long position(int u) const {
+		return base[u >> BLOCK_BITS] + offset[u];
+	}
+
+	// Number of bytes taken by the lists
+	size_t memory() const {
+		return base.size() * sizeof(long long) +
+			   offset.size() * sizeof(uint32_t) + bytes.size();
+	}
+
+	/**
+	 * @brief Decodes the 4 gaps of a group.
+	 *
+	 * @param ctrl the control byte of the group
+	 * @param data the gaps of the group (16 bytes must be readable)
+	 * @param out where the gaps go
+	 * @return the gaps of the next group
+	 */
+	static const uint8_t *decode(uint8_t ctrl, const uint8_t *data,
+								 uint32_t out[4]) {
+#ifdef CGRAPH_SSSE3
+		if (has_ssse3)
+			return decode_ssse3(ctrl, data, out);
+#endif
+		for (int i = 0; i < 4; ++i) {
+			int len = ((ctrl >> (2 * i)) & 3) + 1;
+
+			out[i] = 0;
+			for (int b = 0; b < len; ++b)
+				out[i] |= (uint32_t)data[b] << (8 * b);
+			data += len;
+		}
+
+		return data;
+	}
+
+ private:
+	// Bits of the source looked at by every pass of sort_by_source()
+	static constexpr int RADIX_BITS = 8;
+
+	/**
+	 * @brief
+	 * Time: O((hi - lo) * (shift / RADIX_BITS + 1))
+	 * Auxiliary Space: O(2^RADIX_BITS), on the stack, per pass
+	 *
+	 * Sorts the arcs lo..hi - 1 by source, in place: the arcs are spread
+	 * into 2^RADIX_BITS buckets by the bits of their source from shift up,
+	 * every arc out of place being swapped into the next free place of its
+	 * bucket, then every bucket is sorted by the lower bits. With so few
+	 * buckets, the places being filled stay in the cache, unlike with one
+	 * bucket per node. Short ranges are sorted by insertion.
+	 */
+	static void sort_by_source(avector<int> &from, avector<int> &dest,
+							   avector<int> *weight, size_t lo, size_t hi,
+							   int shift) {
+		auto swap_arcs = [&](size_t i, size_t j) {
+			std::swap(from[i], from[j]);
+			std::swap(dest[i], dest[j]);
+			if (weight)
+				std::swap((*weight)[i], (*weight)[j]);
+		};
+
+		if (hi - lo <= 32) {
+			for (size_t i = lo + 1; i < hi; ++i)
+				for (size_t j = i; j > lo && from[j - 1] > from[j]; --j)
+					swap_arcs(j - 1, j);
+			return;
+		}
+
+		constexpr int BUCKETS = 1 << RADIX_BITS;
+		size_t start[BUCKETS + 1] = {}, next[BUCKETS];
+		auto bucket = [&](size_t i) {
+			return (from[i] >> shift) & (BUCKETS - 1);
+		};
+
+		for (size_t i = lo; i < hi; ++i)
+			++start[bucket(i) + 1];
+		start[0] = lo;
+		for (int b = 0; b < BUCKETS; ++b) {
+			start[b + 1] += start[b];
+			next[b] = start[b];
+		}
+
+		for (int b = 0; b < BUCKETS; ++b) {
+			while (next[b] < start[b + 1]) {
+				size_t i = next[b];
+				int home = bucket(i);
+
+				if (home == b)
+					++next[b];
+				else
+					swap_arcs(i, next[home]++);
+			}
+		}
+
+		if (shift)
+			for (int b = 0; b < BUCKETS; ++b)
+				if (start[b + 1] - start[b] > 1)
+					sort_by_source(from, dest, weight, start[b],
+								   start[b + 1], shift - RADIX_BITS);
+	}
+
+	static uint32_t zigzag(int x) {
+		return ((uint32_t)x << 1) ^ (uint32_t)(x >> 31);
+	}
+
+	static int unzigzag(uint32_t x) {
+		return (int)(x >> 1) ^ -(int)(x & 1);
+	}
+
+	// Gap stored for arc e of node u, whose list (starting at first) is
+	// already sorted
+	static uint32_t gap(const avector<int> &dest, int u, size_t first,
+						size_t e) {
+		return e == first ? zigzag(dest[e] - u) : dest[e] - dest[e - 1];
+	}
+
+	// Number of bytes taken by a gap
+	static int gap_length(uint32_t gap) {
+		return gap < (1u << 8) ? 1 : gap < (1u << 16) ? 2 :
+			   gap < (1u << 24) ? 3 : 4;
+	}
+
+	// Number of bytes taken by a degree
+	static int degree_length(long long degree) {
+		int len = 1;
+
+		while (degree >= 128) {
+			degree >>= 7;
+			++len;
+		}
+		return len;
+	}
+
+	static uint8_t *write_degree(uint8_t *list, long long degree) {
+		while (degree >= 128) {
+			*list++ = (degree & 127) | 128;
+			degree >>= 7;
+		}
+		*list++ = degree;
+
+		return list;
+	}
+
+	// Reads the degree at the start of a list and moves past it
+	static long long read_degree(const uint8_t *&list) {
+		long long degree = 0;
+
+		for (int shift = 0;; shift += 7) {
+			uint8_t byte = *list++;
+
+			degree |= (long long)(byte & 127) << shift;
+			if (!(byte & 128))
+				return degree;
+		}
+	}
+
+	// Number of bytes taken by the weights of a list
+	long long weight_bytes(long long degree) const {
+		return (degree * weight_bits + 7) / 8;
+	}
+
+	// Weight of the i-th arc of a list, whose weights start at weights
+	int weight(const uint8_t *weights, long long i) const {
+		if (!weight_bits)
+			return 0;
+
+		long long bit = i * weight_bits;
+		uint32_t word;
+		memcpy(&word, weights + bit / 8, 4);
+		word >>= bit % 8;
+
+		return weight_bits == 32 ? word : word & ((1u << weight_bits) - 1);
+	}
+
+	void set_weight(uint8_t *weights, long long i, int w) {
+		long long bit = i * weight_bits;
+
+		for (int b = 0; b < weight_bits; ++b)
+			if (w >> b & 1)
+				weights[(bit + b) / 8] |= 1 << ((bit + b) % 8);
+	}
+
+#ifdef CGRAPH_SSSE3
+	// Shuffle masks and group lengths for every control byte
+	struct Tables {
+		alignas(16) uint8_t shuffle[256][16];
+		uint8_t length[256];
+
+		Tables() {
+			for (int ctrl = 0; ctrl < 256; ++ctrl) {
+				int pos = 0;
+
+				for (int i = 0; i < 4; ++i) {
+					int len = ((ctrl >> (2 * i)) & 3) + 1;
+
+					// Bytes past the gap's length are zeroed (0x80)
+					for (int b = 0; b < 4; ++b)
+						shuffle[ctrl][4 * i + b] = b < len ? pos + b : 0x80;
+					pos += len;
+				}
+				length[ctrl] = pos;
+			}
+		}
+	};
+
+	static inline const Tables tables;
+	static inline const bool has_ssse3 = [] {
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("ssse3");
+	}();
+
+	__attribute__((target("ssse3")))
+	static const uint8_t *decode_ssse3(uint8_t ctrl, const uint8_t *data,
+									   uint32_t out[4]) {
+		__m128i in = _mm_loadu_si128((const __m128i *)data);
+		__m128i mask = _mm_load_si128((const __m128i *)tables.shuffle[ctrl]);
+		_mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(in, mask));
+
+		return data + tables.length[ctrl];
+	}
+#endif
+};
+
+#endif  // CGRAPH_H_
@@ -3,6 +3,16 @@
 
 #include <bits/stdc++.h>
 
+#include "arena.h"
+#include "cache.h"
+#include "cgraph.h"
+#include "fileio.h"
+#include "graph.h"
+#include "heap.h"
+#include "reorder.h"
+#include "snapshot.h"
+#include "stats.h"
+
 using namespace std;
 
 // Very large value
@@ -11,70 +21,269 @@ using namespace std;
 class Task {
  public:
 	void solve() {
+		stats.start("ferate");
+		reset();
 		read_input();
-		print_output(get_result());
+
+		// A cached output of the same input takes the place of the rest
+		if (cache.load(hash.digest(), "ferate.out")) {
+			stats.add(stat_cache_hits);
+		} else {
+			stats.add(stat_cache_misses, cache.enabled());
+			build();
+			print_output(get_result());
+			cache.store(hash.digest(), "ferate.out");
+		}
+
+		stats.report();
 	}
 
- private:
-	// Maximum number of nodes
-	static constexpr int NMAX = (int)1e5 + 5;  // 10^5 + 5 = 100.005
+	// Number of heap allocations done by the program so far (see heap.h)
+	size_t heap_allocations() const {
+		return Heap::allocations;
+	}
 
+ private:
 	// A node is a station, and an edge is a rail that connects two stations.
 	// n = number of nodes, m = number of edges, s = source node
 	int n, m, s;
 
-	// adj[aux] = adjacency list of node aux
-	// example: if adj[aux] = {..., neigh, ...} => arc (aux, neigh) exists
-	vector<int> adj[NMAX];
+	// arena = memory for everything below, taken back in bulk by reset()
+	Arena arena;
+
+	// io = the buffer of the input and output files (see fileio.h)
+	char io[1 << 16];
+
+	// scratch = memory for what only lives while the input is read, taken
+	// back by reset() as well and reused by the next solve:
+	// from[i] -> dest[i] = the i-th edge, until the lists are built
+	Arena scratch;
+	avector<int> from{&scratch}, dest{&scratch};
+
+	// adj.adj(aux) = adjacency list of node aux
+	// example: if adj.adj(aux) = {..., neigh, ...} => arc (aux, neigh) exists
+	Graph adj{&arena};
+
+	// cadj = the same lists, compressed (see cgraph.h), used instead of adj
+	// if compressed is true
+	CompressedGraph cadj{&arena};
+	bool compressed;
 
 	// found[i] = discovery time of node i
-	vector<int> found;
+	avector<int> found{&arena};
 	// low_link[i] = lowest discovery time of a node that can be reached from i
-	vector<int> low_link;
+	avector<int> low_link{&arena};
 	// in_stack[i] = true <=> node i is in the stack
-	vector<bool> in_stack;
+	avector<bool> in_stack = avector<bool>(&arena);
 	// st = stack used in Tarjan's algorithm
-	stack<int> st;
+	avector<int> st{&arena};
 	// has_rail[i] = true <=> node i has a rail
-	vector<bool> has_rail;
+	avector<bool> has_rail = avector<bool>(&arena);
 	// redirect[i] = the node that node i redirects to
-	vector<int> redirect;
+	avector<int> redirect{&arena};
 	// has_edge[i] = true <=> node i has an edge to a pseudonode that has
 	// a rail
-	vector<bool> has_edge;
-	// scc = vector that stores the nodes of a SCC
-	vector<int> scc;
+	avector<bool> has_edge = avector<bool>(&arena);
+	// scc_nodes = the nodes of all SCCs, one SCC after the other
+	// scc_start[i] = the position in scc_nodes of the first node of SCC i
+	// scc_of[i] = the SCC whose pseudonode is i, or -1 if i is not one
+	avector<int> scc_nodes{&arena}, scc_start{&arena}, scc_of{&arena};
+
+	// reorder = the new ids of the nodes, if they get relabelled for
+	// locality (see reorder.h)
+	Reorder reorder{&arena};
 	// time = current time, cnt = number of rails, source_dfs = source node
-	int time, cnt = 0, source_dfs;
+	int time, cnt, source_dfs;
+
+	// cache = outputs of earlier inputs (see cache.h), found by the digest of
+	// the input, which hash computes while reading it
+	ResultCache cache{"ferate"};
+	Hasher hash;
+
+	// snapshot = the condensation of earlier graphs (see snapshot.h), found
+	// by the digest of the graph alone (s left out), which graph_hash
+	// computes; snapped = true <=> the one of this graph was found
+	// It holds, in the original ids: the SCC of every node, whether every
+	// SCC has no arc coming in, and the number of such SCCs
+	Snapshot snapshot{"ferate"};
+	Hasher graph_hash;
+	bool snapped;
+	const int *snap_scc;
+	const uint8_t *snap_source;
+	long long snap_sources;
+
+	// stats = instrumentation (see stats.h), with the ids of its counters:
+	// the number of SCCs and of edges taken over by pseudonodes
+	Stats stats;
+	int stat_sccs, stat_merged_edges, stat_adj_bytes;
+	int stat_cache_hits, stat_cache_misses;
+	int stat_snapshot_hits, stat_snapshot_misses;
+
+	/**
+	 * @brief
+	 * Time: O(1)
+	 *
+	 * Empties the containers and takes their memory back, so that the task
+	 * can be solved again, then registers the counters of the new solve.
+	 */
+	void reset() {
+		adj = Graph(&arena);
+		cadj = CompressedGraph(&arena);
+		compressed = CompressedGraph::enabled();
+		found = avector<int>(&arena);
+		low_link = avector<int>(&arena);
+		in_stack = avector<bool>(&arena);
+		st = avector<int>(&arena);
+		has_rail = avector<bool>(&arena);
+		redirect = avector<int>(&arena);
+		has_edge = avector<bool>(&arena);
+		scc_nodes = avector<int>(&arena);
+		scc_start = avector<int>(&arena);
+		reorder = Reorder(&arena);
+		scc_of = avector<int>(&arena);
+		time = 0;
+		cnt = 0;
+		hash = Hasher(cache.enabled());
+		graph_hash = Hasher(snapshot.enabled());
+		snapped = false;
+
+		from = avector<int>(&scratch);
+		dest = avector<int>(&scratch);
+
+		arena.reset();
+		scratch.reset();
+
+		stat_sccs = stats.counter("sccs");
+		stat_merged_edges = stats.counter("merged_edges");
+		stat_adj_bytes = stats.counter("adjacency_bytes");
+		stat_cache_hits = stats.counter("cache_hits");
+		stat_cache_misses = stats.counter("cache_misses");
+		stat_snapshot_hits = stats.counter("snapshot_hits");
+		stat_snapshot_misses = stats.counter("snapshot_misses");
+		reorder.counters(stats);
+	}
+
+	/**
+	 * @brief
+	 * Time: O(degree of node)
+	 *
+	 * Goes through the arcs of a node, in adj or in cadj.
+	 *
+	 * @param node the node
+	 * @param visit called for each neighbour
+	 */
+	template <class F>
+	void for_each_arc(int node, F visit) {
+		if (compressed) {
+			for (auto neigh : cadj.adj(node))
+				visit(neigh);
+		} else {
+			for (auto neigh : adj.adj(node))
+				visit(neigh);
+		}
+	}
+
+	/**
+	 * @brief
+	 * Time: O(degree of node, or of all nodes of its SCC)
+	 *
+	 * Goes through the arcs of a node; for a pseudonode, those are the arcs
+	 * of all the nodes of its SCC, the pseudonode's own coming first.
+	 *
+	 * @param node the node
+	 * @param visit called for each neighbour
+	 */
+	template <class F>
+	void for_each_neigh(int node, F visit) {
+		if (scc_of.empty() || scc_of[node] < 0) {
+			for_each_arc(node, visit);
+			return;
+		}
+
+		int id = scc_of[node];
+		for (int i = scc_start[id]; i < scc_start[id + 1]; ++i)
+			for_each_arc(scc_nodes[i], visit);
+	}
 
 	/**
 	 * @brief
 	 * Time: O(n + m)
-	 * Space: O(n + m), for the adjacency lists
+	 * Space: O(m), for the edges
 	 *
-	 * Reads the input from the file.
+	 * Reads the input from the file, hashing it on the way.
 	 */
 	void read_input() {
+		stats.phase("read_input");
+
 		// Input file
-		ifstream fin("ferate.in");
+		Reader fin("ferate.in", io, sizeof(io));
 
 		// Reads n, m and s
 		fin >> n >> m >> s;
+		hash.add(n);
+		hash.add(m);
+		hash.add(s);
+		graph_hash.add(n);
+		graph_hash.add(m);
+
+		// Initializes the edges
+		from.reserve(m);
+		dest.reserve(m);
 
 		// Reads the edges
 		for (int i = 1, x, y; i <= m; i++) {
 			fin >> x >> y;
-			adj[x].push_back(y);
+			hash.item(x, y);
+			graph_hash.item(x, y);
+			from.push_back(x);
+			dest.push_back(y);
+		}
+
+		// Close the input file
+		fin.close();
+	}
+
+	/**
+	 * @brief
+	 * Time: O(n + m)
+	 * Space: O(n + m), for the adjacency lists
+	 *
+	 * Relabels the nodes and builds the lists from the edges read, unless
+	 * the snapshot of the graph makes them useless.
+	 */
+	void build() {
+		// With the snapshot of the graph, neither the lists nor the SCCs are
+		// needed any more
+		if (load_snapshot())
+			return;
+
+		// Relabels the nodes, which changes no answer
+		if (reorder.enabled()) {
+			stats.phase("reorder");
+			reorder.relabel(stats, n, from, dest, {}, &scratch);
+			s = reorder.id(s);
+		}
+
+		// Builds the adjacency lists
+		stats.phase("build_lists");
+		if (compressed) {
+			cadj.build(n, from, dest, nullptr, &scratch);
+			stats.add(stat_adj_bytes, cadj.memory());
+		} else {
+			adj.build(n, from, dest);
+			stats.add(stat_adj_bytes, adj.memory());
 		}
 
+		// The edges are not needed any more
+		from = avector<int>(&scratch);
+		dest = avector<int>(&scratch);
+		scratch.trim();
+
 		// Initializes the redirection vector
 		redirect.resize(n + 1);
 		for (int i = 1; i <= n; ++i) {
 			redirect[i] = i;
 		}
-
-		// Close the input file
-		fin.close();
 	}
 
 	/**
@@ -91,7 +300,7 @@ class Task {
 		has_rail[node] = true;
 
 		// Goes through the neighbours of the node
-		for (auto aux_neigh : adj[node]) {
+		for_each_neigh(node, [this](int aux_neigh) {
 			// Gets the pseudonode that the neighbour redirects to
 			int neigh = redirect[aux_neigh];
 
@@ -105,7 +314,7 @@ class Task {
 				has_edge[neigh] = false;
 				--cnt;
 			}
-		}
+		});
 	}
 
 	/**
@@ -113,27 +322,27 @@ class Task {
 	 * Time: O(n + m)
 	 * Auxiliary Space: O(n), for the helper vectors
 	 *
-	 * Tarjan's algorithm for finding the SCCs.
+	 * Tarjan's algorithm for finding the SCCs, which are stored in scc_nodes
+	 * and scc_start.
 	 *
-	 * @param all_sccs vector that stores all the SCCs
 	 * @param u the current node
 	 */
-	void tarjan(vector< vector<int> > &all_sccs, int u) {
+	void tarjan(int u) {
 		int aux;
 
 		// Sets the discovery time and the low link of the node
 		found[u] = low_link[u] = ++time;
 
 		// Pushes the node in the stack and sets it as being in the stack
-		st.push(u);
+		st.push_back(u);
 		in_stack[u] = true;
 
 		// Goes through the neighbours of the node
-		for (auto v : adj[u]) {
+		for_each_arc(u, [this, u](int v) {
 			// If the neighbour hasn't been visited and it doesn't have a rail,
 			// then it is visited
 			if (found[v] == INF && !has_rail[v]) {
-				tarjan(all_sccs, v);
+				tarjan(v);
 
 				// Updates the low link of the node
 				low_link[u] = min(low_link[u], low_link[v]);
@@ -142,33 +351,30 @@ class Task {
 			} else if (in_stack[v]) {
 				low_link[u] = min(low_link[u], low_link[v]);
 			}
-		}
+		});
 
 		// If the low link of the node is equal to its discovery time, then a
 		// SCC has been found
 		if (found[u] == low_link[u]) {
-			// Clears the SCC vector
-			scc.clear();
-
 			// Gets the nodes of the SCC
 			do {
-				aux = st.top();
-				st.pop();
+				aux = st.back();
+				st.pop_back();
 
 				// Sets the node as not being in the stack
 				in_stack[aux] = false;
 
-				scc.push_back(aux);
+				scc_nodes.push_back(aux);
 			} while (aux != u);
 
-			// Adds the SCC to the vector of SCCs
-			all_sccs.push_back(scc);
+			// Marks the end of the SCC
+			scc_start.push_back(scc_nodes.size());
 		}
 	}
 
 	/**
 	 * @brief
-	 * Time: O(n + m)
+	 * Time: O(n + m), O(1) with the snapshot of the graph
 	 * Space: O(n + m), overall
 	 *
 	 * Finds the minimum number of rails that need to be built.
@@ -176,7 +382,16 @@ class Task {
 	 * @return the minimum number of rails that need to be built
 	 */
 	int get_result() {
-		vector<vector<int>> all_sccs;
+		// The snapshot of the graph already has the answer for any source
+		if (snapped) {
+			stats.phase("snapshot_answer");
+			return snap_sources - snap_source[snap_scc[s]];
+		}
+
+		// The condensation of the whole graph, which goes to the snapshot,
+		// gives the answer as well, so the passes below are not needed
+		if (snapshot.enabled())
+			return save_snapshot();
 
 		// Initializes the vectors
 		found.resize(n + 1, INF);
@@ -184,39 +399,52 @@ class Task {
 		in_stack.resize(n + 1, false);
 		has_rail.resize(n + 1, false);
 		has_edge.resize(n + 1, false);
+		st.reserve(n);
+		scc_nodes.reserve(n);
+		scc_start.reserve(n + 1);
+		scc_start.push_back(0);
 
 		// Sets the inital nodes that have rails
+		stats.phase("dfs_source");
 		dfs(s);
 
 		// Gets the SCCs
+		stats.phase("tarjan");
 		for (int i = 1; i <= n; ++i) {
 			if (found[i] == INF && !has_rail[i]) {
-				tarjan(all_sccs, i);
+				tarjan(i);
 			}
 		}
 
 		// Redirects the nodes to the pseudonodes
+		stats.phase("merge");
+		stats.add(stat_sccs, scc_start.size() - 1);
+		scc_of.resize(n + 1, -1);
 		// Goes through all the SCCs
-		for (auto &scc : all_sccs) {
+		for (int id = 0; id + 1 < (int)scc_start.size(); ++id) {
+			// The pseudonode is the first node of the SCC, and it takes over
+			// the edges of all the nodes of the SCC (see for_each_neigh)
+			int pseudonode = scc_nodes[scc_start[id]];
+			scc_of[pseudonode] = id;
+
 			// Goes through all the nodes of the SCC
-			for (auto &node : scc) {
-				// The pseudonode is the first node of the SCC
-				redirect[node] = scc[0];
+			for (int i = scc_start[id]; i < scc_start[id + 1]; ++i) {
+				int node = scc_nodes[i];
+
+				redirect[node] = pseudonode;
 				// If the node is the first node of the SCC, then it is skipped
-				if (node == scc[0]) {
+				if (node == pseudonode) {
 					continue;
 				}
-				// Adds the edges of all neighbours of the node to the
-				// pseudonode
-				for (auto &neigh : adj[node]) {
-					adj[scc[0]].push_back(neigh);
-				}
 				// Sets the node as having a rail
 				has_rail[node] = true;
+				stats.add(stat_merged_edges, compressed ? cadj.degree(node) :
+						  adj.degree(node));
 			}
 		}
 
 		// Counts the number of rails that need to be built
+		stats.phase("count");
 		for (int i = 1; i <= n; ++i) {
 			// If the node has a rail, then it is skipped
 			if (has_rail[i]) {
@@ -236,19 +464,115 @@ class Task {
 		return cnt;
 	}
 
+	/**
+	 * @brief
+	 * Time: O(size of the snapshot)
+	 *
+	 * Maps the snapshot of the graph, if there is one. A rail must then be
+	 * built to every SCC with no arc coming in, except for that of s: every
+	 * other SCC is reached from one of them, and no such SCC is reached from
+	 * s unless it is its own.
+	 *
+	 * @return whether it was found
+	 */
+	bool load_snapshot() {
+		if (!snapshot.enabled())
+			return false;
+
+		stats.phase("snapshot_load");
+		if (snapshot.load(graph_hash.digest(), 3)) {
+			size_t nodes, sccs, count;
+
+			snap_scc = snapshot.array<int>(0, nodes);
+			snap_source = snapshot.array<uint8_t>(1, sccs);
+			snap_sources = *snapshot.array<long long>(2, count);
+			snapped = nodes == (size_t)n + 1 && count == 1 && s >= 1 &&
+					  s <= n && snap_scc[s] >= 0 &&
+					  (size_t)snap_scc[s] < sccs;
+		}
+
+		if (snapped) {
+			stats.add(stat_snapshot_hits);
+		} else {
+			stats.add(stat_snapshot_misses);
+		}
+
+		return snapped;
+	}
+
+	/**
+	 * @brief
+	 * Time: O(n + m)
+	 * Auxiliary Space: O(n), for the helper vectors
+	 *
+	 * Finds the SCCs of the whole graph (unlike get_result(), which leaves
+	 * out the nodes reached from s) and which of them have no arc coming in,
+	 * then writes them to the snapshot of the graph. The answer follows as
+	 * it does from a loaded snapshot (see load_snapshot()).
+	 *
+	 * @return the minimum number of rails that need to be built
+	 */
+	int save_snapshot() {
+		stats.phase("tarjan");
+
+		// Tarjan's algorithm, with no node left out
+		found.assign(n + 1, INF);
+		low_link.resize(n + 1);
+		in_stack.assign(n + 1, false);
+		has_rail.assign(n + 1, false);
+		st.reserve(n);
+		scc_nodes.reserve(n);
+		scc_start.assign(1, 0);
+		for (int i = 1; i <= n; ++i) {
+			if (found[i] == INF) {
+				tarjan(i);
+			}
+		}
+
+		stats.phase("snapshot_save");
+
+		// scc[i] = the SCC of node i, in the original ids
+		auto original = [this](int node) {
+			return reorder.enabled() ? reorder.original(node) : node;
+		};
+		int sccs = scc_start.size() - 1;
+		avector<int> scc(n + 1, 0, &arena);
+		for (int id = 0; id < sccs; ++id)
+			for (int i = scc_start[id]; i < scc_start[id + 1]; ++i)
+				scc[original(scc_nodes[i])] = id;
+
+		// source[i] = 1 <=> no arc comes into SCC i from another SCC
+		avector<uint8_t> source(sccs, 1, &arena);
+		for (int u = 1; u <= n; ++u)
+			for_each_arc(u, [&](int v) {
+				if (scc[original(u)] != scc[original(v)])
+					source[scc[original(v)]] = 0;
+			});
+		long long sources = count(source.begin(), source.end(), 1);
+
+		snapshot.save(graph_hash.digest(),
+					  {{scc.data(), scc.size() * sizeof(int)},
+					   {source.data(), source.size()},
+					   {&sources, sizeof(sources)}});
+
+		return sources - source[scc[original(s)]];
+	}
+
 	/**
 	 * @brief Prints the result.
 	 *
 	 * @param cnt the number of rails that need to be built
 	 */
 	void print_output(int cnt) {
-		ofstream fout("ferate.out");
+		stats.phase("print_output");
+
+		Writer fout("ferate.out", io, sizeof(io));
 		fout << cnt << '\n';
 		fout.close();
 	}
 };
 
-int main() {
+int main(int argc, char *argv[]) {
 	auto* task = new (nothrow) Task();
 
 	if (!task) {
@@ -256,7 +580,21 @@ int main() {
 		return -1;
 	}
 
-	task->solve();
+	// runs = how many times the input is solved (1 by default); with more
+	// than one, the heap allocations of every run are reported, which should
+	// drop to 0 once the arena is warm
+	int runs = argc > 1 ? atoi(argv[1]) : 1;
+
+	for (int run = 1; run <= runs; ++run) {
+		size_t allocations = task->heap_allocations();
+
+		task->solve();
+
+		if (runs > 1)
+			cerr << "run " << run << ": "
+				 << task->heap_allocations() - allocations
+				 << " heap allocations\n";
+	}
 
 	delete task;
 
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+#ifndef FILEIO_H_
+#define FILEIO_H_
+
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * Input and output files of a solver, read and written through a buffer that
+ * the solver owns.
+ *
+ * They stand in for ifstream and ofstream, which allocate a buffer and a FILE
+ * every time a file is opened: here the file is opened with open(2) and
+ * nothing touches the heap, so a warm solve does not allocate at all (see
+ * heap.h). Only whitespace-separated integers are read, and only integers,
+ * characters and strings are written, which is all the solvers need.
+ */
+class Reader {
+ public:
+	Reader(const char *path, char *buffer, size_t size)
+		: buffer(buffer), size(size) {
+		fd = ::open(path, O_RDONLY);
+	}
+
+	~Reader() {
+		close();
+	}
+
+	Reader(const Reader &) = delete;
+	Reader &operator=(const Reader &) = delete;
+
+	// Reads an integer, or leaves 0 in x if the file has no more of them
+	template <class T>
+	Reader &operator>>(T &x) {
+		static_assert(std::is_integral_v<T>, "only integers are read");
+
+		int c = next();
+		while (c != EOF && c <= ' ')
+			c = next();
+
+		bool negative = c == '-';
+		if (negative)
+			c = next();
+
+		x = 0;
+		while (c >= '0' && c <= '9') {
+			x = x * 10 + (c - '0');
+			c = next();
+		}
+		if (negative)
+			x = -x;
+
+		return *this;
+	}
+
+	void close() {
+		if (fd >= 0)
+			::close(fd);
+		fd = -1;
+	}
+
+ private:
+	int fd;
+	// buffer[pos..end) = the bytes read but not yet parsed
+	char *buffer;
+	size_t size, pos = 0, end = 0;
+
+	int next() {
+		if (pos == end) {
+			ssize_t got = fd < 0 ? 0 : ::read(fd, buffer, size);
+
+			if (got <= 0)
+				return EOF;
+			pos = 0;
+			end = got;
+		}
+
+		return (unsigned char)buffer[pos++];
+	}
+};
+
+class Writer {
+ public:
+	Writer(const char *path, char *buffer, size_t size)
+		: buffer(buffer), size(size) {
+		fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	}
+
+	~Writer() {
+		close();
+	}
+
+	Writer(const Writer &) = delete;
+	Writer &operator=(const Writer &) = delete;
+
+	template <class T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+	Writer &operator<<(T x) {
+		char digits[24];
+		int len = 0;
+		bool negative = x < 0;
+
+		// Digit by digit, from the last one, without overflowing on the
+		// smallest value
+		do {
+			int digit = x % 10;
+			digits[len++] = '0' + (digit < 0 ? -digit : digit);
+			x /= 10;
+		} while (x);
+		if (negative)
+			put('-');
+		while (len)
+			put(digits[--len]);
+
+		return *this;
+	}
+
+	Writer &operator<<(char c) {
+		put(c);
+		return *this;
+	}
+
+	Writer &operator<<(const char *text) {
+		while (*text)
+			put(*text++);
+		return *this;
+	}
+
+	// Writes out what is left in the buffer, then closes the file
+	void close() {
+		if (fd < 0)
+			return;
+
+		flush();
+		::close(fd);
+		fd = -1;
+	}
+
+ private:
+	int fd;
+	// buffer[0..used) = the bytes not yet written out
+	char *buffer;
+	size_t size, used = 0;
+
+	void put(char c) {
+		if (used == size)
+			flush();
+		buffer[used++] = c;
+	}
+
+	void flush() {
+		for (size_t done = 0; done < used && fd >= 0;) {
+			ssize_t wrote = ::write(fd, buffer + done, used - done);
+
+			if (wrote <= 0)
+				break;
+			done += wrote;
+		}
+		used = 0;
+	}
+};
+
+#endif  // FILEIO_H_
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+#ifndef GRAPH_H_
+#define GRAPH_H_
+
+#include "arena.h"
+
+// An arc, as seen from its source: destination and weight (0 if unweighted)
+struct Arc {
+	int to, w;
+};
+
+/**
+ * Adjacency lists stored back to back (compressed sparse row).
+ *
+ * The arcs of node u are to[start[u]], ..., to[start[u + 1] - 1], in the
+ * order in which they were added. w[] holds the arc weights, if any.
+ */
+struct Graph {
+	// Range of neighbours, usable in range-based for loops
+	struct Range {
+		const int *first, *last;
+
+		const int *begin() const {
+			return first;
+		}
+		const int *end() const {
+			return last;
+		}
+	};
+
+	// Range of arcs, usable in range-based for loops
+	struct ArcRange {
+		struct Iterator {
+			const Graph *g;
+			int e;
+
+			Arc operator*() const {
+				return {g->to[e], g->w.empty() ? 0 : g->w[e]};
+			}
+			Iterator &operator++() {
+				++e;
+				return *this;
+			}
+			bool operator!=(const Iterator &other) const {
+				return e != other.e;
+			}
+		};
+
+		const Graph *g;
+		int first, last;
+
+		Iterator begin() const {
+			return {g, first};
+		}
+		Iterator end() const {
+			return {g, last};
+		}
+	};
+
+	// n = number of nodes
+	int n = 0;
+	avector<int> start, to, w;
+
+	explicit Graph(Arena *arena) : start(arena), to(arena), w(arena) {}
+
+	/**
+	 * @brief
+	 * Time: O(n + m)
+	 * Space: O(n + m)
+	 *
+	 * Builds the lists from the arcs (from[i], dest[i]), i = 0..m - 1, with
+	 * weight[i] attached if weight is not null.
+	 */
+	void build(int nodes, const avector<int> &from, const avector<int> &dest,
+			   const avector<int> *weight = nullptr) {
+		n = nodes;
+
+		// Counts the arcs going out of each node
+		start.assign(n + 2, 0);
+		for (auto x : from)
+			++start[x + 1];
+
+		// Turns the counts into offsets
+		for (int i = 1; i <= n + 1; ++i)
+			start[i] += start[i - 1];
+
+		// Places the arcs, keeping their order; start[u] is moved forward
+		// while filling and then shifted back
+		to.resize(from.size());
+		if (weight)
+			w.resize(from.size());
+		for (size_t i = 0; i < from.size(); ++i) {
+			int pos = start[from[i]]++;
+
+			to[pos] = dest[i];
+			if (weight)
+				w[pos] = (*weight)[i];
+		}
+		for (int i = n + 1; i > 0; --i)
+			start[i] = start[i - 1];
+		start[0] = 0;
+	}
+
+	// Neighbours of node u
+	Range adj(int u) const {
+		return {to.data() + start[u], to.data() + start[u + 1]};
+	}
+
+	// Arcs going out of node u
+	ArcRange arcs(int u) const {
+		return {this, start[u], start[u + 1]};
+	}
+
+	// Number of arcs going out of node u
+	int degree(int u) const {
+		return start[u + 1] - start[u];
+	}
+
+	// Number of bytes taken by the lists
+	size_t memory() const {
+		return (start.size() + to.size() + w.size()) * sizeof(int);
+	}
+};
+
+#endif  // GRAPH_H_
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+#ifndef HEAP_H_
+#define HEAP_H_
+
+#include <bits/stdc++.h>
+
+/**
+ * Counter of the heap allocations of the whole program.
+ *
+ * The global operator new is replaced by one that counts its calls, so
+ * every container, stream buffer and arena block is seen, not only the
+ * blocks of the arenas. As the replacements may only be defined once, this
+ * header is included by the solver's source alone.
+ */
+struct Heap {
+	// Number of calls to operator new since the start of the program
+	static inline size_t allocations = 0;
+};
+
+void *operator new(size_t size) {
+	++Heap::allocations;
+	if (void *block = malloc(size ? size : 1))
+		return block;
+	throw std::bad_alloc();
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+	++Heap::allocations;
+	return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept {
+	return operator new(size, tag);
+}
+
+void operator delete(void *block) noexcept {
+	free(block);
+}
+
+void operator delete[](void *block) noexcept {
+	free(block);
+}
+
+void operator delete(void *block, const std::nothrow_t &) noexcept {
+	free(block);
+}
+
+void operator delete[](void *block, const std::nothrow_t &) noexcept {
+	free(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+	free(block);
+}
+
+void operator delete[](void *block, size_t) noexcept {
+	free(block);
+}
+
+#endif  // HEAP_H_
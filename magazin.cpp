@@ -3,6 +3,15 @@
 
 #include <bits/stdc++.h>
 
+#include "arena.h"
+#include "cache.h"
+#include "fileio.h"
+#include "graph.h"
+#include "heap.h"
+#include "reorder.h"
+#include "snapshot.h"
+#include "stats.h"
+
 using namespace std;
 
 // Non-existent node
@@ -11,26 +20,53 @@ using namespace std;
 class Task {
  public:
 	void solve() {
+		stats.start("magazin");
+		reset();
 		read_input();
-		print_output(get_result());
+
+		// A cached output of the same input takes the place of the rest
+		if (cache.load(hash.digest(), "magazin.out")) {
+			stats.add(stat_cache_hits);
+		} else {
+			stats.add(stat_cache_misses, cache.enabled());
+			build();
+			print_output(get_result());
+			cache.store(hash.digest(), "magazin.out");
+		}
+
+		stats.report();
 	}
 
- private:
-	// Maximum number of nodes
-	static constexpr int NMAX = (int)1e5 + 5;  // 10^5 + 5 = 100.005
+	// Number of heap allocations done by the program so far (see heap.h)
+	size_t heap_allocations() const {
+		return Heap::allocations;
+	}
 
+ private:
 	// A node is a deposit and an edge is a link that indicates that the
 	// deposit at the source of the link can be used to fill the deposit at
 	// the destination of the link
 	// n = number of nodes, q = number of queries
 	int n, q;
 
-	// adj[aux] = adjacency list of node aux
-	// example: if adj[aux] = {..., neigh, ...} => arc (aux, neigh) exists
-	vector<int> adj[NMAX];
+	// arena = memory for everything below, taken back in bulk by reset()
+	Arena arena;
+
+	// io = the buffer of the input and output files (see fileio.h)
+	char io[1 << 16];
+
+	// scratch = memory for what only lives while the input is read, taken
+	// back by reset() as well and reused by the next solve:
+	// from[i] -> dest[i] = the i-th edge, until the lists are built
+	Arena scratch;
+	avector<int> from{&scratch}, dest{&scratch};
+
+	// adj.adj(aux) = adjacency list of node aux
+	// example: if adj.adj(aux) = {..., neigh, ...} => arc (aux, neigh) exists
+	Graph adj{&arena};
 
 	// queries[i] = (d, e) => the i-th query is (d, e)
-	vector<pair<int, int>> queries;
+	avector<pair<int, int>> queries{&arena};
 
 	// answers[i] = the answer for the i-th query
 	// started[i] = the start time of the i-th node in the DFS
@@ -38,32 +74,106 @@ class Task {
 	// path[i] = the i-th node in the DFS path
 	// position[i] = the position of the i-th node in the DFS path
 	// parent[i] = the parent of the i-th node in the DFS tree
-	vector<int> answers, started, finished, path, position, parent;
+	avector<int> answers{&arena}, started{&arena}, finished{&arena};
+	avector<int> path{&arena}, position{&arena}, parent{&arena};
+
+	// reorder = the new ids of the nodes, if they get relabelled for
+	// locality (see reorder.h)
+	Reorder reorder{&arena};
 
 	// time = current timestamp in the DFS
-	int time = 0;
+	int time;
+
+	// cache = outputs of earlier inputs (see cache.h), found by the digest of
+	// the input, which hash computes while reading it
+	ResultCache cache{"magazin"};
+	Hasher hash;
+
+	// snapshot = the DFS of earlier trees (see snapshot.h), found by the
+	// digest of the tree alone (the queries left out), which graph_hash
+	// computes; snapped = true <=> the one of this tree was found
+	// It holds path, position, started and finished, in the original ids
+	Snapshot snapshot{"magazin"};
+	Hasher graph_hash;
+	bool snapped;
+
+	// stats = instrumentation (see stats.h), with the ids of its counters:
+	// the queries that have an answer (hits) and those that do not (misses)
+	Stats stats;
+	int stat_hits, stat_misses;
+	int stat_cache_hits, stat_cache_misses;
+	int stat_snapshot_hits, stat_snapshot_misses;
+
+	/**
+	 * @brief
+	 * Time: O(1)
+	 *
+	 * Empties the containers and takes their memory back, so that the task
+	 * can be solved again, then registers the counters of the new solve.
+	 */
+	void reset() {
+		adj = Graph(&arena);
+		queries = avector<pair<int, int>>(&arena);
+		answers = avector<int>(&arena);
+		started = avector<int>(&arena);
+		finished = avector<int>(&arena);
+		path = avector<int>(&arena);
+		position = avector<int>(&arena);
+		parent = avector<int>(&arena);
+		reorder = Reorder(&arena);
+		time = 0;
+		hash = Hasher(cache.enabled());
+		graph_hash = Hasher(snapshot.enabled());
+		snapped = false;
+
+		from = avector<int>(&scratch);
+		dest = avector<int>(&scratch);
+
+		arena.reset();
+		scratch.reset();
+
+		stat_hits = stats.counter("query_hits");
+		stat_misses = stats.counter("query_misses");
+		stat_cache_hits = stats.counter("cache_hits");
+		stat_cache_misses = stats.counter("cache_misses");
+		stat_snapshot_hits = stats.counter("snapshot_hits");
+		stat_snapshot_misses = stats.counter("snapshot_misses");
+		reorder.counters(stats);
+	}
 
 	/**
 	 * @brief
 	 * Time: O(n + q)
-	 * Space: O(n + q), for the adjacency lists and the queries
+	 * Space: O(n + q), for the edges and the queries
 	 *
-	 * Reads the input from the file.
+	 * Reads the input from the file, hashing it on the way.
 	 */
 	void read_input() {
+		stats.phase("read_input");
+
 		// Input file
-		ifstream fin("magazin.in");
+		Reader fin("magazin.in", io, sizeof(io));
 
 		// Reads n and q
 		fin >> n >> q;
+		hash.add(n);
+		hash.add(q);
+		graph_hash.add(n);
 
 		// Initializes the queries
 		queries.reserve(q + 1);
 
+		// Initializes the edges
+		from.reserve(n);
+		dest.reserve(n);
+
 		// Reads the edges
 		for (int i = 1, x; i < n; ++i) {
 			fin >> x;
-			adj[x].push_back(i + 1);
+			hash.add(x);
+			graph_hash.add(x);
+			from.push_back(x);
+			dest.push_back(i + 1);
 		}
 
 		// Adds a dummy query
@@ -72,6 +182,8 @@ class Task {
 		// Reads the queries
 		for (int i = 1, d, e; i <= q; ++i) {
 			fin >> d >> e;
+			hash.add(d);
+			hash.add(e);
 			queries.push_back({d, e});
 		}
 
@@ -79,6 +191,114 @@ class Task {
 		fin.close();
 	}
 
+	/**
+	 * @brief
+	 * Time: O(n + q)
+	 * Space: O(n), for the adjacency lists
+	 *
+	 * Builds the lists from the edges read, unless the snapshot of the tree
+	 * makes them useless.
+	 */
+	void build() {
+		// With the snapshot of the tree, the lists are not needed; without
+		// it, the nodes are relabelled, except for the root (the lists keep
+		// the children in their original order, so the DFS visits them
+		// alike), and the lists are built
+		if (!load_snapshot()) {
+			if (reorder.enabled()) {
+				stats.phase("reorder");
+				reorder.relabel(stats, n, from, dest, {1}, &scratch);
+				for (int i = 1; i <= q; ++i)
+					queries[i].first = reorder.id(queries[i].first);
+			}
+
+			stats.phase("build_lists");
+			adj.build(n, from, dest);
+		}
+
+		// The edges are not needed any more
+		from = avector<int>(&scratch);
+		dest = avector<int>(&scratch);
+		scratch.trim();
+	}
+
+	// Whether the nodes were relabelled (never with the snapshot, which is in
+	// the original ids)
+	bool relabelled() const {
+		return reorder.enabled() && !snapped;
+	}
+
+	/**
+	 * @brief
+	 * Time: O(size of the snapshot)
+	 *
+	 * Maps the snapshot of the tree, if there is one.
+	 *
+	 * @return whether it was found
+	 */
+	bool load_snapshot() {
+		if (!snapshot.enabled())
+			return false;
+
+		stats.phase("snapshot_load");
+		if (snapshot.load(graph_hash.digest(), 4)) {
+			size_t sizes[4];
+
+			for (int i = 0; i < 4; ++i)
+				snapshot.array<int>(i, sizes[i]);
+			snapped = sizes[0] <= (size_t)n && sizes[1] == (size_t)n + 1 &&
+					  sizes[2] == (size_t)n + 1 && sizes[3] == (size_t)n + 1;
+		}
+
+		if (snapped) {
+			stats.add(stat_snapshot_hits);
+		} else {
+			stats.add(stat_snapshot_misses);
+		}
+
+		return snapped;
+	}
+
+	/**
+	 * @brief
+	 * Time: O(n)
+	 * Auxiliary Space: O(n), for the copies in the original ids
+	 *
+	 * Writes path, position, started and finished to the snapshot of the
+	 * tree, in the original ids.
+	 */
+	void save_snapshot() {
+		stats.phase("snapshot_save");
+
+		if (!relabelled()) {
+			snapshot.save(graph_hash.digest(),
+						  {{path.data(), path.size() * sizeof(int)},
+						   {position.data(), position.size() * sizeof(int)},
+						   {started.data(), started.size() * sizeof(int)},
+						   {finished.data(), finished.size() * sizeof(int)}});
+			return;
+		}
+
+		// The path gets the original ids, the others their original order
+		avector<int> path_of(path.size(), 0, &arena);
+		for (size_t i = 0; i < path.size(); ++i)
+			path_of[i] = reorder.original(path[i]);
+		avector<int> position_of(n + 1, 0, &arena);
+		avector<int> started_of(n + 1, 0, &arena);
+		avector<int> finished_of(n + 1, 0, &arena);
+		for (int node = 1; node <= n; ++node) {
+			position_of[node] = position[reorder.id(node)];
+			started_of[node] = started[reorder.id(node)];
+			finished_of[node] = finished[reorder.id(node)];
+		}
+
+		snapshot.save(graph_hash.digest(),
+					  {{path_of.data(), path_of.size() * sizeof(int)},
+					   {position_of.data(), position_of.size() * sizeof(int)},
+					   {started_of.data(), started_of.size() * sizeof(int)},
+					   {finished_of.data(), finished_of.size() * sizeof(int)}});
+	}
+
 	/**
 	 * @brief
 	 * Time: O(n)
@@ -102,7 +322,7 @@ class Task {
 		position[node] = path.size() - 1;
 
 		// Traverse the neighbours of the current node
-		for (auto neigh : adj[node]) {
+		for (auto neigh : adj.adj(node)) {
 			// If the neighbour is not visited, visit it
 			if (parent[neigh] == NIL) {
 				parent[neigh] = node;
@@ -116,24 +336,48 @@ class Task {
 
 	/**
 	 * @brief
-	 * Time: O(n + q)
+	 * Time: O(n + q), O(q) with the snapshot of the tree
 	 * Space: O(n + q), overall
 	 *
 	 * Computes the answer for each query.
 	 *
 	 * @return the answers for each query
 	*/
-	vector<int> get_result() {
+	const avector<int> &get_result() {
 		// Initializations
 		answers.resize(q + 1, NIL);
-		parent.resize(n + 1, NIL);
-		path.reserve(n + 1);
-		position.resize(n + 1, 0);
-		started.resize(n + 1, 0);
-		finished.resize(n + 1, 0);
 
-		// DFS traversal of the tree
-		dfs(1);
+		// The DFS arrays, from the snapshot of the tree or from the DFS
+		const int *path_at, *position_at, *started_at, *finished_at;
+		size_t path_size, size;
+
+		if (snapped) {
+			path_at = snapshot.array<int>(0, path_size);
+			position_at = snapshot.array<int>(1, size);
+			started_at = snapshot.array<int>(2, size);
+			finished_at = snapshot.array<int>(3, size);
+		} else {
+			parent.resize(n + 1, NIL);
+			path.reserve(n + 1);
+			position.resize(n + 1, 0);
+			started.resize(n + 1, 0);
+			finished.resize(n + 1, 0);
+
+			// DFS traversal of the tree
+			stats.phase("dfs");
+			dfs(1);
+
+			// Keeps it for the next runs
+			if (snapshot.enabled())
+				save_snapshot();
+
+			path_at = path.data();
+			path_size = path.size();
+			position_at = position.data();
+			started_at = started.data();
+			finished_at = finished.data();
+		}
+		stats.phase("queries");
 
 		// Computes the answer for each query
 		for (int i = 1; i <= q; ++i) {
@@ -146,17 +390,24 @@ class Task {
 			// If the node is not visited or the number of steps is greater
 			// than the number of nodes in the path from the node to all the
 			// children of the node, then the answer is -1
-			if (e > finished[d] - started[d]) {
+			if (e > finished_at[d] - started_at[d]) {
+				stats.add(stat_misses);
 				continue;
 			}
 
 			// The node's position in the path
-			auto start = position[d];
+			auto start = position_at[d];
 
 			// If the required node is in the path, then the answer is the
 			// node at e steos after the given node d
-			if (start + e < (int)path.size())
-				answers[i] = path[start + e];
+			if (start + e < (int)path_size) {
+				answers[i] = relabelled() ?
+							 reorder.original(path_at[start + e]) :
+							 path_at[start + e];
+				stats.add(stat_hits);
+			} else {
+				stats.add(stat_misses);
+			}
 		}
 
 		// Returns the answers
@@ -168,8 +419,10 @@ class Task {
 	 *
 	 * @param answers the answers for each query
 	*/
-	void print_output(const vector<int>& answers) {
-		ofstream fout("magazin.out");
+	void print_output(const avector<int>& answers) {
+		stats.phase("print_output");
+
+		Writer fout("magazin.out", io, sizeof(io));
 
 		for (auto i = 1; i <= q; ++i)
 			fout << answers[i] << '\n';
@@ -178,7 +431,7 @@ class Task {
 	}
 };
 
-int main() {
+int main(int argc, char *argv[]) {
 	auto* task = new (nothrow) Task();
 
 	if (!task) {
@@ -186,7 +439,21 @@ int main() {
 		return -1;
 	}
 
-	task->solve();
+	// runs = how many times the input is solved (1 by default); with more
+	// than one, the heap allocations of every run are reported, which should
+	// drop to 0 once the arena is warm
+	int runs = argc > 1 ? atoi(argv[1]) : 1;
+
+	for (int run = 1; run <= runs; ++run) {
+		size_t allocations = task->heap_allocations();
+
+		task->solve();
+
+		if (runs > 1)
+			cerr << "run " << run << ": "
+				 << task->heap_allocations() - allocations
+				 << " heap allocations\n";
+	}
 
 	delete task;
 
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+#ifndef ROWS_H_
+#define ROWS_H_
+
+#include <bits/stdc++.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ROWS_X86 1
+#endif
+
+/**
+ * Relaxation of a row of costs into another: dst[j] = min(dst[j], src[j] + w
+ * + mask[j]), where the mask (0 or a huge value per lane) lets only some of
+ * the lanes through.
+ *
+ * Rows of 64-bit costs are relaxed 8 lanes at a time with AVX-512, 4 at a
+ * time with AVX2 (a compare and a blend, as AVX2 has no 64-bit min), or one
+ * at a time otherwise; the widest one the CPU supports is picked at runtime.
+ */
+struct Rows {
+	/**
+	 * @brief Relaxes src, rotated by shift lanes, into dst: lane r of src
+	 * goes to lane (r + shift) % len of dst.
+	 *
+	 * @param dst the row that is lowered
+	 * @param src the row whose costs are added to
+	 * @param len the length of both rows
+	 * @param shift the rotation, between 0 and len - 1
+	 * @param w the cost added to every lane
+	 * @param mask the costs added to every lane of src, or nullptr for none
+	 * @return whether any lane of dst was lowered
+	 */
+	static bool relax_rotated(long long *dst, const long long *src, int len,
+							  int shift, long long w, const long long *mask) {
+		bool lowered = relax(dst + shift, src, len - shift, w, mask);
+
+		if (shift)
+			lowered |= relax(dst, src + len - shift, shift, w,
+							 mask ? mask + len - shift : nullptr);
+
+		return lowered;
+	}
+
+	/**
+	 * @brief Relaxes src into dst, lane by lane.
+	 *
+	 * @return whether any lane of dst was lowered
+	 */
+	static bool relax(long long *dst, const long long *src, int len,
+					  long long w, const long long *mask) {
+#ifdef ROWS_X86
+		if (level == 2)
+			return relax_avx512(dst, src, len, w, mask);
+		if (level == 1)
+			return relax_avx2(dst, src, len, w, mask);
+#endif
+		return relax_scalar(dst, src, len, w, mask, 0);
+	}
+
+ private:
+	// 2 = AVX-512, 1 = AVX2, 0 = scalar; AP_ROWS_ISA ("avx2" or "scalar")
+	// may ask for less than what the CPU supports
+	static inline const int level = [] {
+		const char *env = getenv("AP_ROWS_ISA");
+		int most = !env ? 2 : !strcmp(env, "avx2") ? 1 :
+				   !strcmp(env, "scalar") ? 0 : 2;
+#ifdef ROWS_X86
+		__builtin_cpu_init();
+		if (most >= 2 && __builtin_cpu_supports("avx512f"))
+			return 2;
+		if (most >= 1 && __builtin_cpu_supports("avx2"))
+			return 1;
+#endif
+		return 0;
+	}();
+
+	static bool relax_scalar(long long *dst, const long long *src, int len,
+							 long long w, const long long *mask, int from) {
+		bool lowered = false;
+
+		for (int j = from; j < len; ++j) {
+			long long cost = src[j] + w + (mask ? mask[j] : 0);
+
+			if (cost < dst[j]) {
+				dst[j] = cost;
+				lowered = true;
+			}
+		}
+
+		return lowered;
+	}
+
+#ifdef ROWS_X86
+	__attribute__((target("avx2")))
+	static bool relax_avx2(long long *dst, const long long *src, int len,
+						   long long w, const long long *mask) {
+		__m256i add = _mm256_set1_epi64x(w), lowered = _mm256_setzero_si256();
+		int j = 0;
+
+		for (; j + 4 <= len; j += 4) {
+			__m256i cost = _mm256_add_epi64(
+				_mm256_loadu_si256((const __m256i *)(src + j)), add);
+			if (mask)
+				cost = _mm256_add_epi64(
+					cost, _mm256_loadu_si256((const __m256i *)(mask + j)));
+
+			__m256i old = _mm256_loadu_si256((const __m256i *)(dst + j));
+			__m256i lower = _mm256_cmpgt_epi64(old, cost);
+
+			_mm256_storeu_si256((__m256i *)(dst + j),
+								_mm256_blendv_epi8(old, cost, lower));
+			lowered = _mm256_or_si256(lowered, lower);
+		}
+
+		return !_mm256_testz_si256(lowered, lowered) |
+			   relax_scalar(dst, src, len, w, mask, j);
+	}
+
+	__attribute__((target("avx512f")))
+	static bool relax_avx512(long long *dst, const long long *src, int len,
+							 long long w, const long long *mask) {
+		__m512i add = _mm512_set1_epi64(w);
+		__mmask8 lowered = 0;
+		int j = 0;
+
+		for (; j + 8 <= len; j += 8) {
+			__m512i cost = _mm512_add_epi64(_mm512_loadu_si512(src + j), add);
+			if (mask)
+				cost = _mm512_add_epi64(cost, _mm512_loadu_si512(mask + j));
+
+			__m512i old = _mm512_loadu_si512(dst + j);
+
+			lowered |= _mm512_cmpgt_epi64_mask(old, cost);
+			_mm512_storeu_si512(dst + j, _mm512_min_epi64(old, cost));
+		}
+
+		return lowered | relax_scalar(dst, src, len, w, mask, j);
+	}
+#endif
+};
+
+#endif  // ROWS_H_
@@ -0,0 +1,233 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+
+/**
+ * Snapshot of what a solver computes from the graph alone, so that a later
+ * run on the same graph (with other queries or another source) can skip it.
+ *
+ * Off unless AP_SNAPSHOT_DIR names a directory (created if missing). The
+ * snapshot of a graph is <dir>/<problem>-<digest>.snap, where the digest is
+ * that of the graph as it was read (see Hasher), and holds a few arrays:
+ *
+ *   header   magic "APSNAP", version, number of arrays, digest, checksum
+ *   sizes    the size in bytes of every array (8 bytes each)
+ *   arrays   one after the other, each padded to a multiple of 8 bytes
+ *
+ * The checksum is the XXH64 of the sizes and the arrays. A snapshot is
+ * mapped into memory and used in place; one with another version, digest or
+ * checksum, or a truncated one, is ignored (and later overwritten).
+ */
+class Snapshot {
+ public:
+	static constexpr unsigned VERSION = 1;
+
+	explicit Snapshot(const char *problem) : problem(problem) {
+		const char *env = getenv("AP_SNAPSHOT_DIR");
+		if (!env || !*env)
+			return;
+
+		dir = env;
+		mkdir(dir.c_str(), 0755);
+	}
+
+	~Snapshot() {
+		unmap();
+	}
+
+	Snapshot(const Snapshot &) = delete;
+	Snapshot &operator=(const Snapshot &) = delete;
+
+	bool enabled() const {
+		return !dir.empty();
+	}
+
+	/**
+	 * @brief Maps the snapshot of a graph, if there is a valid one.
+	 *
+	 * @param digest the digest of the graph
+	 * @param arrays the number of arrays it must have
+	 * @return whether it was mapped
+	 */
+	bool load(unsigned long long digest, unsigned arrays) {
+		unmap();
+		if (!enabled())
+			return false;
+
+		int fd = open(path(digest).c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		if (!fstat(fd, &st) && (size_t)st.st_size >= sizeof(Header)) {
+			void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE,
+							  fd, 0);
+
+			if (addr != MAP_FAILED) {
+				data = (const char *)addr;
+				size = st.st_size;
+			}
+		}
+		close(fd);
+
+		if (!data || !valid(digest, arrays)) {
+			unmap();
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief Array i of the mapped snapshot.
+	 *
+	 * @param count where its number of elements goes
+	 */
+	template <class T>
+	const T *array(unsigned i, size_t &count) const {
+		const uint64_t *sizes = (const uint64_t *)(data + sizeof(Header));
+		size_t offset = sizeof(Header) + header().arrays * sizeof(uint64_t);
+
+		for (unsigned j = 0; j < i; ++j)
+			offset += padded(sizes[j]);
+		count = sizes[i] / sizeof(T);
+
+		return (const T *)(data + offset);
+	}
+
+	/**
+	 * @brief Writes the snapshot of a graph.
+	 *
+	 * @param digest the digest of the graph
+	 * @param arrays the arrays, as (start, size in bytes)
+	 */
+	void save(unsigned long long digest,
+			  std::initializer_list<std::pair<const void *, size_t>> arrays) {
+		if (!enabled())
+			return;
+
+		Header head;
+		memcpy(head.magic, MAGIC, sizeof(head.magic));
+		head.version = VERSION;
+		head.arrays = arrays.size();
+		head.digest = digest;
+
+		std::vector<uint64_t> sizes;
+		for (auto &[start, bytes] : arrays)
+			sizes.push_back(bytes);
+
+		Hasher sum(true);
+		hash(sum, sizes.data(), sizes.size() * sizeof(uint64_t));
+		for (auto &[start, bytes] : arrays)
+			hash(sum, start, bytes);
+		head.checksum = sum.digest();
+
+		// Written aside and renamed, so that no run maps half a snapshot
+		std::string file = path(digest);
+		std::string temp = file + ".tmp" + std::to_string(getpid());
+		std::ofstream fout(temp, std::ios::binary);
+		static const char zeros[8] = {};
+
+		fout.write((const char *)&head, sizeof(head));
+		fout.write((const char *)sizes.data(), sizes.size() * sizeof(uint64_t));
+		for (auto &[start, bytes] : arrays) {
+			fout.write((const char *)start, bytes);
+			fout.write(zeros, padded(bytes) - bytes);
+		}
+		fout.close();
+
+		if (!fout || rename(temp.c_str(), file.c_str()))
+			unlink(temp.c_str());
+	}
+
+ private:
+	static constexpr char MAGIC[8] = "APSNAP";
+
+	struct Header {
+		char magic[8];
+		uint32_t version, arrays;
+		uint64_t digest, checksum;
+	};
+
+	const char *problem;
+	std::string dir;
+	// data = the mapped snapshot, of size bytes
+	const char *data = nullptr;
+	size_t size = 0;
+
+	static size_t padded(size_t bytes) {
+		return (bytes + 7) & ~(size_t)7;
+	}
+
+	// Feeds bytes to a hasher, 8 at a time (the last ones padded with 0)
+	static void hash(Hasher &sum, const void *start, size_t bytes) {
+		const char *p = (const char *)start;
+
+		for (size_t i = 0; i < bytes; i += 8) {
+			uint64_t word = 0;
+
+			memcpy(&word, p + i, std::min<size_t>(8, bytes - i));
+			sum.add(word);
+		}
+	}
+
+	const Header &header() const {
+		return *(const Header *)data;
+	}
+
+	bool valid(unsigned long long digest, unsigned arrays) const {
+		const Header &head = header();
+
+		if (memcmp(head.magic, MAGIC, sizeof(head.magic)) ||
+			head.version != VERSION || head.digest != digest ||
+			head.arrays != arrays ||
+			sizeof(Header) + arrays * sizeof(uint64_t) > size)
+			return false;
+
+		const uint64_t *sizes = (const uint64_t *)(data + sizeof(Header));
+		size_t total = sizeof(Header) + arrays * sizeof(uint64_t);
+		for (unsigned i = 0; i < arrays; ++i) {
+			if (sizes[i] > size)
+				return false;
+			total += padded(sizes[i]);
+		}
+		if (total != size)
+			return false;
+
+		Hasher sum(true);
+		hash(sum, sizes, arrays * sizeof(uint64_t));
+		size_t offset = sizeof(Header) + arrays * sizeof(uint64_t);
+		for (unsigned i = 0; i < arrays; ++i) {
+			hash(sum, data + offset, sizes[i]);
+			offset += padded(sizes[i]);
+		}
+
+		return sum.digest() == head.checksum;
+	}
+
+	std::string path(unsigned long long digest) const {
+		char name[64];
+
+		snprintf(name, sizeof(name), "/%s-%016llx.snap", problem, digest);
+		return dir + name;
+	}
+
+	void unmap() {
+		if (data)
+			munmap((void *)data, size);
+		data = nullptr;
+		size = 0;
+	}
+};
+
+#endif  // SNAPSHOT_H_
@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: EUPL-1.2
+/* Copyright Mitran Andrei-Gabriel 2023 */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <bits/stdc++.h>
+#include <sys/resource.h>
+
+#ifdef AP_STATS
+
+/**
+ * Per-phase timers and algorithm counters of a solve.
+ *
+ * Only compiled in with -DAP_STATS (make STATS=1), and only reported when the
+ * AP_STATS environment variable is set (and not "0"). Each solve prints one
+ * JSON line on stderr:
+ *
+ * {"task":"ferate","run":1,"phases":[{"name":"read_input","wall_s":0.01,
+ *  "peak_rss_kb":2048}, ...],"counters":{"sccs":12, ...}}
+ *
+ * peak_rss_kb is the peak memory of the process at the end of the phase.
+ * Everything is kept in fixed arrays, so it never allocates.
+ */
+class Stats {
+ public:
+	Stats() {
+		const char *env = getenv("AP_STATS");
+		enabled = env && strcmp(env, "0");
+	}
+
+	/**
+	 * @brief Forgets the previous solve and starts a new one.
+	 *
+	 * @param name the name of the task
+	 */
+	void start(const char *name) {
+		task = name;
+		++run;
+		phases = counters = 0;
+		open = false;
+	}
+
+	/**
+	 * @brief Ends the current phase, if any, and starts a new one.
+	 *
+	 * @param name the name of the new phase
+	 */
+	void phase(const char *name) {
+		if (!enabled)
+			return;
+
+		end_phase();
+		if (phases == MAX_PHASES)
+			return;
+
+		phase_name[phases] = name;
+		phase_start = std::chrono::steady_clock::now();
+		open = true;
+	}
+
+	/**
+	 * @brief Registers a counter, starting at 0.
+	 *
+	 * @param name the name of the counter
+	 * @return the id used to update the counter
+	 */
+	int counter(const char *name) {
+		if (counters == MAX_COUNTERS)
+			return MAX_COUNTERS - 1;
+
+		counter_name[counters] = name;
+		value[counters] = 0;
+		return counters++;
+	}
+
+	// Adds delta to a counter
+	void add(int id, long long delta = 1) {
+		value[id] += delta;
+	}
+
+	// Raises a counter to x, if x is greater (for high-water marks)
+	void high(int id, long long x) {
+		value[id] = std::max(value[id], x);
+	}
+
+	// Ends the last phase and prints the JSON line
+	void report() {
+		if (!enabled)
+			return;
+
+		end_phase();
+
+		fprintf(stderr, "{\"task\":\"%s\",\"run\":%d,\"phases\":[", task, run);
+		for (int i = 0; i < phases; ++i)
+			fprintf(stderr, "%s{\"name\":\"%s\",\"wall_s\":%.6f,"
+					"\"peak_rss_kb\":%ld}", i ? "," : "", phase_name[i],
+					phase_wall[i], phase_rss[i]);
+		fprintf(stderr, "],\"counters\":{");
+		for (int i = 0; i < counters; ++i)
+			fprintf(stderr, "%s\"%s\":%lld", i ? "," : "", counter_name[i],
+					value[i]);
+		fprintf(stderr, "}}\n");
+	}
+
+ private:
+	static constexpr int MAX_PHASES = 16, MAX_COUNTERS = 16;
+
+	bool enabled, open = false;
+	const char *task = "";
+	int run = 0, phases = 0, counters = 0;
+
+	const char *phase_name[MAX_PHASES];
+	double phase_wall[MAX_PHASES];
+	long phase_rss[MAX_PHASES];
+	std::chrono::steady_clock::time_point phase_start;
+
+	const char *counter_name[MAX_COUNTERS];
+	long long value[MAX_COUNTERS];
+
+	void end_phase() {
+		if (!open)
+			return;
+
+		std::chrono::duration<double> wall =
+			std::chrono::steady_clock::now() - phase_start;
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+
+		phase_wall[phases] = wall.count();
+		phase_rss[phases] = usage.ru_maxrss;
+		++phases;
+		open = false;
+	}
+};
+
+#else
+
+// Instrumentation compiled out: every call is empty and goes away
+class Stats {
+ public:
+	void start(const char *) {}
+	void phase(const char *) {}
+	int counter(const char *) {
+		return 0;
+	}
+	void add(int, long long = 1) {}
+	void high(int, long long) {}
+	void report() {}
+};
+
+#endif  // AP_STATS
+
+#endif  // STATS_H_
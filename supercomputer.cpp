@@ -3,48 +3,146 @@
 
 #include <bits/stdc++.h>
 
+#include "arena.h"
+#include "cache.h"
+#include "cgraph.h"
+#include "fileio.h"
+#include "graph.h"
+#include "heap.h"
+#include "reorder.h"
+#include "stats.h"
+
 using namespace std;
 
 class Task {
  public:
 	void solve() {
+		stats.start("supercomputer");
+		reset();
 		read_input();
-		print_output(get_result());
+
+		// A cached output of the same input takes the place of the rest
+		if (cache.load(hash.digest(), "supercomputer.out")) {
+			stats.add(stat_cache_hits);
+		} else {
+			stats.add(stat_cache_misses, cache.enabled());
+			build();
+			print_output(get_result());
+			cache.store(hash.digest(), "supercomputer.out");
+		}
+
+		stats.report();
 	}
 
- private:
-	// Maximum number of nodes
-	static constexpr int NMAX = (int)1e5 + 5;  // 10^5 + 5 = 100.005
+	// Number of heap allocations done by the program so far (see heap.h)
+	size_t heap_allocations() const {
+		return Heap::allocations;
+	}
 
+ private:
 	// A node is a task, and an edge is a dependency between two tasks.
 	// n = number of nodes, m = number of edges
 	int n, m;
 
-	// adj[aux] = adjacency list of node aux
-	// example: if adj[aux] = {..., neigh, ...} => arc (aux, neigh) exists
-	vector<int> adj[NMAX];
+	// arena = memory for everything below, taken back in bulk by reset()
+	Arena arena;
+
+	// io = the buffer of the input and output files (see fileio.h)
+	char io[1 << 16];
+
+	// scratch = memory for what only lives while the input is read, taken
+	// back by reset() as well and reused by the next solve:
+	// from[i] -> dest[i] = the i-th edge, until the lists are built
+	Arena scratch;
+	avector<int> from{&scratch}, dest{&scratch};
+
+	// adj.adj(aux) = adjacency list of node aux
+	// example: if adj.adj(aux) = {..., neigh, ...} => arc (aux, neigh) exists
+	Graph adj{&arena};
+
+	// cadj = the same lists, compressed (see cgraph.h), used instead of adj
+	// if compressed is true
+	CompressedGraph cadj{&arena};
+	bool compressed;
 
 	// vertices_cnt[i] = number of nodes that point to node i
-	vector<unsigned long> vertices_cnt;
+	avector<unsigned long> vertices_cnt{&arena};
 
 	// data_set[i] = 1 if vertex i requires data set 1; or 2 otherwise
-	vector<int> data_set;
+	avector<int> data_set{&arena};
+
+	// reorder = the new ids of the nodes, if they get relabelled for
+	// locality (see reorder.h)
+	Reorder reorder{&arena};
+
+	// cache = outputs of earlier inputs (see cache.h), found by the digest of
+	// the input, which hash computes while reading it
+	ResultCache cache{"supercomputer"};
+	Hasher hash;
+
+	// stats = instrumentation (see stats.h), with the ids of its counters:
+	// the context switches when starting from each data set and the largest
+	// size reached by each queue
+	Stats stats;
+	int stat_switches[3], stat_q1_high, stat_q2_high, stat_adj_bytes;
+	int stat_cache_hits, stat_cache_misses;
+
+	/**
+	 * @brief
+	 * Time: O(1)
+	 *
+	 * Empties the containers and takes their memory back, so that the task
+	 * can be solved again, then registers the counters of the new solve.
+	 */
+	void reset() {
+		adj = Graph(&arena);
+		cadj = CompressedGraph(&arena);
+		compressed = CompressedGraph::enabled();
+		vertices_cnt = avector<unsigned long>(&arena);
+		data_set = avector<int>(&arena);
+		reorder = Reorder(&arena);
+		hash = Hasher(cache.enabled());
+
+		from = avector<int>(&scratch);
+		dest = avector<int>(&scratch);
+
+		arena.reset();
+		scratch.reset();
+
+		stat_switches[1] = stats.counter("context_switches_from_1");
+		stat_switches[2] = stats.counter("context_switches_from_2");
+		stat_q1_high = stats.counter("q1_high_water");
+		stat_q2_high = stats.counter("q2_high_water");
+		stat_adj_bytes = stats.counter("adjacency_bytes");
+		stat_cache_hits = stats.counter("cache_hits");
+		stat_cache_misses = stats.counter("cache_misses");
+		reorder.counters(stats);
+	}
 
 	/**
 	 * @brief
 	 * Time: O(n + m)
-	 * Space: O(n + m), for the adjacency lists
+	 * Space: O(n + m), for the edges and the data sets
 	 *
-	 * Reads the input from the file.
+	 * Reads the input from the file, hashing it on the way.
 	 */
 	void read_input() {
+		stats.phase("read_input");
+
 		// Input file
-		ifstream fin("supercomputer.in");
+		Reader fin("supercomputer.in", io, sizeof(io));
 
 		// Reads n and m
 		fin >> n >> m;
+		hash.add(n);
+		hash.add(m);
+
+		// Initializes the edges
+		from.reserve(m);
+		dest.reserve(m);
 
 		// Adds a dummy node
+		data_set.reserve(n + 1);
 		data_set.push_back(0);
 
 		// Initializes the number of nodes that point to each node
@@ -53,20 +151,55 @@ class Task {
 		// Reads the data set for each node
 		for (int i = 1, set; i <= n; ++i) {
 			fin >> set;
+			hash.add(set);
 			data_set.push_back(set);
 		}
 
 		// Reads the edges
 		for (int i = 1, x, y; i <= m; ++i) {
 			fin >> x >> y;
+			hash.item(x, y);
 			++vertices_cnt[y];
-			adj[x].push_back(y);
+			from.push_back(x);
+			dest.push_back(y);
 		}
 
 		// Closes the input file
 		fin.close();
 	}
 
+	/**
+	 * @brief
+	 * Time: O(n + m)
+	 * Space: O(n + m), for the adjacency lists
+	 *
+	 * Relabels the nodes and builds the lists from the edges read.
+	 */
+	void build() {
+		// Relabels the nodes, which changes no answer
+		if (reorder.enabled()) {
+			stats.phase("reorder");
+			reorder.relabel(stats, n, from, dest, {}, &scratch);
+			reorder.permute(data_set);
+			reorder.permute(vertices_cnt);
+		}
+
+		// Builds the adjacency lists
+		stats.phase("build_lists");
+		if (compressed) {
+			cadj.build(n, from, dest, nullptr, &scratch);
+			stats.add(stat_adj_bytes, cadj.memory());
+		} else {
+			adj.build(n, from, dest);
+			stats.add(stat_adj_bytes, adj.memory());
+		}
+
+		// The edges are not needed any more
+		from = avector<int>(&scratch);
+		dest = avector<int>(&scratch);
+		scratch.trim();
+	}
+
 	/**
 	 * @brief
 	 * Time: O(n + m)
@@ -75,19 +208,20 @@ class Task {
 	 * Utilizes the topological sort algorithm to find the minimum
 	 * number of context switches.
 	 *
+	 * @param g The adjacency lists (adj or cadj).
 	 * @param switched If true, the starting queue is q2; or q1 otherwise.
 	 * It is used to start from both data sets at some point in order to
 	 * make sure that the minimum number of context switches is found.
 	 *
 	 * @return The minimum number of context switches.
 	 */
-	int topo_sort_cnt(bool switched) {
+	template <class G>
+	int topo_sort_cnt(const G &g, bool switched) {
 		// q1 = queue for data set 1, q2 = queue for data set 2
-		queue<int> q1, q2;
+		aqueue<int> q1(&arena), q2(&arena);
 
-		// vertices_cnt_copy = copy of vertices_cnt
-		vector<unsigned long> *vertices_cnt_copy =
-			new vector<unsigned long> (vertices_cnt);
+		// vertices_cnt_copy = copy of vertices_cnt, in the arena
+		avector<unsigned long> vertices_cnt_copy(vertices_cnt, &arena);
 
 		// context_switches = number of times the context was switched
 		int context_switches = 0, q1_data_set, q2_data_set;
@@ -104,13 +238,15 @@ class Task {
 		// Adds the nodes that have no dependencies to the queues if they
 		// require their respective data set
 		for (int i = 1; i <= n; ++i) {
-			if ((*vertices_cnt_copy)[i] == 0 && data_set[i] == q1_data_set) {
+			if (vertices_cnt_copy[i] == 0 && data_set[i] == q1_data_set) {
 				q1.push(i);
 			}
-			if ((*vertices_cnt_copy)[i] == 0 && data_set[i] == q2_data_set) {
+			if (vertices_cnt_copy[i] == 0 && data_set[i] == q2_data_set) {
 				q2.push(i);
 			}
 		}
+		stats.high(stat_q1_high, q1.size());
+		stats.high(stat_q2_high, q2.size());
 
 		// Stops when there are no more nodes to be processed
 		while (!q1.empty() || !q2.empty()) {
@@ -123,18 +259,20 @@ class Task {
 				int node = q1.front();
 				q1.pop();
 
-				for (auto neigh : adj[node]) {
-					--(*vertices_cnt_copy)[neigh];
-					if ((*vertices_cnt_copy)[neigh] == 0 && data_set[neigh] ==
+				for (auto neigh : g.adj(node)) {
+					--vertices_cnt_copy[neigh];
+					if (vertices_cnt_copy[neigh] == 0 && data_set[neigh] ==
 						q1_data_set) {
 						q1.push(neigh);
 					}
 
-					if ((*vertices_cnt_copy)[neigh] == 0 && data_set[neigh] ==
+					if (vertices_cnt_copy[neigh] == 0 && data_set[neigh] ==
 						q2_data_set) {
 						q2.push(neigh);
 					}
 				}
+				stats.high(stat_q1_high, q1.size());
+				stats.high(stat_q2_high, q2.size());
 			}
 
 			// If the queue is not empty, the context is switched
@@ -147,18 +285,20 @@ class Task {
 				int node = q2.front();
 				q2.pop();
 
-				for (auto neigh : adj[node]) {
-					--(*vertices_cnt_copy)[neigh];
-					if ((*vertices_cnt_copy)[neigh] == 0 && data_set[neigh] ==
+				for (auto neigh : g.adj(node)) {
+					--vertices_cnt_copy[neigh];
+					if (vertices_cnt_copy[neigh] == 0 && data_set[neigh] ==
 						q1_data_set) {
 						q1.push(neigh);
 					}
 
-					if ((*vertices_cnt_copy)[neigh] == 0 && data_set[neigh] ==
+					if (vertices_cnt_copy[neigh] == 0 && data_set[neigh] ==
 						q2_data_set) {
 						q2.push(neigh);
 					}
 				}
+				stats.high(stat_q1_high, q1.size());
+				stats.high(stat_q2_high, q2.size());
 			}
 
 			// If the queue is not empty, the context is switched
@@ -167,8 +307,7 @@ class Task {
 			}
 		}
 
-		// Deletes the copy of vertices_cnt
-		delete vertices_cnt_copy;
+		stats.add(stat_switches[q1_data_set], context_switches);
 
 		// Returns the minimum number of context switches
 		return context_switches;
@@ -185,12 +324,16 @@ class Task {
 	 * @return The minimum number of context switches.
 	 */
 	int get_result() {
+		stats.phase("topo_sort");
+
 		// Initializes the number of nodes that point to each node
 		vertices_cnt.resize(n + 1);
 
 		// Finds the minimum number of context switches by starting from
 		// the queues for both data sets
-		int context_switches = min(topo_sort_cnt(false), topo_sort_cnt(true));
+		int context_switches = compressed ?
+			min(topo_sort_cnt(cadj, false), topo_sort_cnt(cadj, true)) :
+			min(topo_sort_cnt(adj, false), topo_sort_cnt(adj, true));
 
 		return context_switches;
 	}
@@ -201,13 +344,15 @@ class Task {
 	 * @param context_switches The minimum number of context switches.
 	 */
 	void print_output(const int context_switches ) {
-		ofstream fout("supercomputer.out");
+		stats.phase("print_output");
+
+		Writer fout("supercomputer.out", io, sizeof(io));
 		fout << context_switches << '\n';
 		fout.close();
 	}
 };
 
-int main() {
+int main(int argc, char *argv[]) {
 	auto* task = new (nothrow) Task();
 
 	if (!task) {
@@ -215,7 +360,21 @@ int main() {
 		return -1;
 	}
 
-	task->solve();
+	// runs = how many times the input is solved (1 by default); with more
+	// than one, the heap allocations of every run are reported, which should
+	// drop to 0 once the arena is warm
+	int runs = argc > 1 ? atoi(argv[1]) : 1;
+
+	for (int run = 1; run <= runs; ++run) {
+		size_t allocations = task->heap_allocations();
+
+		task->solve();
+
+		if (runs > 1)
+			cerr << "run " << run << ": "
+				 << task->heap_allocations() - allocations
+				 << " heap allocations\n";
+	}
 
 	delete task;
 
@@ -3,6 +3,17 @@
 
 #include <bits/stdc++.h>
 
+#include "arena.h"
+#include "cache.h"
+#include "cgraph.h"
+#include "fileio.h"
+#include "graph.h"
+#include "heap.h"
+#include "reorder.h"
+#include "rows.h"
+#include "snapshot.h"
+#include "stats.h"
+
 using namespace std;
 
 // Non-existent node
@@ -14,34 +25,209 @@ using namespace std;
 class Task {
  public:
 	void solve() {
+		stats.start("teleportare");
+		reset();
 		read_input();
-		print_output(get_result());
+
+		// A cached output of the same input takes the place of the rest
+		if (cache.load(hash.digest(), "teleportare.out")) {
+			stats.add(stat_cache_hits);
+		} else {
+			stats.add(stat_cache_misses, cache.enabled());
+			build();
+			print_output(get_result());
+			cache.store(hash.digest(), "teleportare.out");
+		}
+
+		stats.report();
 	}
 
- private:
-	// Maximum number of nodes
-	static constexpr int NMAX = (int)1e5 + 5;  // 10^5 + 5 = 100.005
-	static constexpr int PMAX = (int)845;  // 845 = 3 * 5 * 7 * 8 + 5
+	// Number of heap allocations done by the program so far (see heap.h)
+	size_t heap_allocations() const {
+		return Heap::allocations;
+	}
 
+ private:
 	// A node is a room and an edge is a corridor
-	// n = number of nodes, m = number of edges, k = number of portals
-	int n, m, k;
+	// n = number of nodes, m = number of edges, k = number of portals,
+	// q = number of queries listed after the portals (0 if there are none)
+	int n, m, k, q;
+
+	// arena = memory for everything below, taken back in bulk by reset()
+	Arena arena;
+
+	// io = the buffer of the input and output files (see fileio.h)
+	char io[1 << 16];
 
-	// adj[aux] = adjacency list of node aux
-	// example: if adj[aux] = {..., neigh, ...} => arc (aux, neigh) exists
-	// portal_adj[aux] = adjacency list of node aux, but only for portals
-	// example: if portal_adj[aux] = {..., neigh, ...} => there is a portal
-	// from aux to neigh
-	vector<pair<int, int>> adj[NMAX], portal_adj[NMAX];
+	// scratch = memory for what only lives while the input is read, taken
+	// back by reset() as well and reused by the next solve:
+	// from[i] -> dest[i] = the i-th corridor arc and weight[i] = its cost,
+	// portal_from, portal_dest and period = the same for the portals, until
+	// the lists are built
+	Arena scratch;
+	avector<int> from{&scratch}, dest{&scratch}, weight{&scratch};
+	avector<int> portal_from{&scratch}, portal_dest{&scratch};
+	avector<int> period{&scratch};
 
-	// P[i][j] = the minimum cost to reach node i at time j
+	// adj.adj(aux) = adjacency list of node aux, adj.w[] = corridor costs
+	// example: if adj.adj(aux) = {..., neigh, ...} => arc (aux, neigh) exists
+	// portal_adj.adj(aux) = adjacency list of node aux, but only for portals,
+	// with portal_adj.w[] = portal periods
+	// example: if portal_adj.adj(aux) = {..., neigh, ...} => there is a
+	// portal from aux to neigh
+	Graph adj{&arena}, portal_adj{&arena};
+
+	// cadj, portal_cadj = the same lists, compressed (see cgraph.h), used
+	// instead of adj and portal_adj if compressed is true
+	CompressedGraph cadj{&arena}, portal_cadj{&arena};
+	bool compressed;
+
+	// P[i * lcm_aux + j] = state(i, j) = the minimum cost to reach node i at
+	// time j
 	// It acts as a simple visited array, but it also stores the minimum cost
 	// to reach a node at a certain time, for every combination remainders for
 	// the portal periods
-	long long P[NMAX][PMAX];
+	avector<long long> P{&arena};
 
 	// lcm_aux = the least common multiple of all portal periods
-	int lcm_aux = 1;
+	int lcm_aux;
+
+	// queries[i] = (source, target, departure time) of the i-th query; with
+	// none listed in the input (listed = false), the only one is (1, n, 0)
+	// answers[i] = the minimum cost of the i-th query, or -1
+	bool listed;
+	avector<array<int, 3>> queries{&arena};
+	avector<long long> answers{&arena};
+
+	// search_arena = memory for the queues of a single search, taken back
+	// before the next one, so that the searches of many queries (or the
+	// walks of the overlay) do not pile up
+	Arena search_arena;
+
+	// reorder = the new ids of the nodes, if they get relabelled for
+	// locality (see reorder.h)
+	Reorder reorder{&arena};
+
+	// use_rows = whether the rows engine (see rows()) is used instead of
+	// dijkstra()
+	bool use_rows;
+
+	// profile = whether the arrival times for every departure time modulo
+	// lcm_aux are computed (see profile_search()), instead of the one for
+	// departing at time 0
+	// arrival[t] = the time of arrival at n when departing at time t, or -1
+	bool profile;
+	avector<long long> arrival{&arena};
+
+	// The overlay (see prepare_overlay()), used if use_overlay is true and
+	// it pays off, or always if force_overlay is true. It depends on the map
+	// alone (the corridors and the portals, not the queries), which is found
+	// by its digest, map_hash. It lives in an arena of its own, as it is kept
+	// across solves of the same map (overlay_key = its digest, 0 if there is
+	// no overlay), and in the snapshot of the map (see snapshot.h), if
+	// AP_SNAPSHOT_DIR is set.
+	// overlay_original[a] = the a-th node of the overlay, in the original ids
+	// overlay_dist[(a * overlay_size + b) * lcm_aux + r] = the length of the
+	// shortest walk along corridors from node a to node b of the overlay
+	// whose length is r modulo lcm_aux
+	// overlay_node[a] = the a-th node of the overlay, overlay_id[i] = the
+	// index of node i in the overlay, or NIL (both in the ids of this solve)
+	bool use_overlay, force_overlay;
+	Arena overlay_arena;
+	unsigned long long overlay_key = 0;
+	int overlay_size = 0;
+	avector<int> overlay_original{&overlay_arena};
+	avector<long long> overlay_dist{&overlay_arena};
+	avector<int> overlay_node{&arena}, overlay_id{&arena};
+	Snapshot snapshot{"teleportare"};
+	Hasher map_hash;
+
+	// Largest overlay_dist that may be built
+	static constexpr size_t OVERLAY_MAX_DIST = 1 << 24;
+
+	// search_work, overlay_work = the estimates of the work of a search of
+	// the map and of one of the overlay (see prepare_overlay())
+	double search_work, overlay_work;
+
+	// cache = outputs of earlier inputs (see cache.h), found by the digest of
+	// the input, which hash computes while reading it
+	ResultCache cache{"teleportare"};
+	Hasher hash;
+
+	// stats = instrumentation (see stats.h), with the ids of its counters:
+	// the pushes into the heap and the pops, out of which the stale ones
+	Stats stats;
+	int stat_pushes, stat_pops, stat_stale_pops, stat_adj_bytes;
+	int stat_cache_hits, stat_cache_misses;
+	int stat_overlay_nodes, stat_overlay_states;
+	int stat_rows, stat_row_relaxations;
+
+	/**
+	 * @brief
+	 * Time: O(1)
+	 *
+	 * Empties the containers and takes their memory back, so that the task
+	 * can be solved again, then registers the counters of the new solve.
+	 */
+	void reset() {
+		adj = Graph(&arena);
+		portal_adj = Graph(&arena);
+		cadj = CompressedGraph(&arena);
+		portal_cadj = CompressedGraph(&arena);
+		compressed = CompressedGraph::enabled();
+		P = avector<long long>(&arena);
+		lcm_aux = 1;
+		reorder = Reorder(&arena);
+		arrival = avector<long long>(&arena);
+		queries = avector<array<int, 3>>(&arena);
+		answers = avector<long long>(&arena);
+		overlay_node = avector<int>(&arena);
+		overlay_id = avector<int>(&arena);
+
+		const char *env = getenv("AP_TELEPORT_OVERLAY");
+		use_overlay = env && strcmp(env, "0");
+		force_overlay = env && !strcmp(env, "always");
+		env = getenv("AP_TELEPORT_ENGINE");
+		use_rows = env && !strcmp(env, "rows");
+		env = getenv("AP_TELEPORT_PROFILE");
+		profile = env && strcmp(env, "0");
+		hash = Hasher(cache.enabled());
+		// A profile is another output for the same input
+		hash.add(profile);
+		map_hash = Hasher(use_overlay);
+
+		from = avector<int>(&scratch);
+		dest = avector<int>(&scratch);
+		weight = avector<int>(&scratch);
+		portal_from = avector<int>(&scratch);
+		portal_dest = avector<int>(&scratch);
+		period = avector<int>(&scratch);
+
+		arena.reset();
+		scratch.reset();
+
+		stat_pushes = stats.counter("heap_pushes");
+		stat_pops = stats.counter("heap_pops");
+		stat_stale_pops = stats.counter("stale_pops");
+		stat_adj_bytes = stats.counter("adjacency_bytes");
+		stat_cache_hits = stats.counter("cache_hits");
+		stat_cache_misses = stats.counter("cache_misses");
+		reorder.counters(stats);
+		stat_overlay_nodes = stats.counter("overlay_nodes");
+		stat_overlay_states = stats.counter("overlay_build_pops");
+		stat_rows = stats.counter("rows_processed");
+		stat_row_relaxations = stats.counter("row_relaxations");
+	}
+
+	/**
+	 * @brief
+	 * Time: O(1)
+	 *
+	 * @return P entry for reaching node at a time congruent to time.
+	 */
+	long long &state(int node, long long time) {
+		return P[(size_t)node * lcm_aux + time % lcm_aux];
+	}
 
 	/**
 	 * @brief
@@ -67,36 +253,96 @@ class Task {
 		return a * b / gcd(a, b);
 	}
 
+	/**
+	 * @brief
+	 * Time: O(n + number of arcs)
+	 *
+	 * Builds the lists of the weighted arcs (tails[i], heads[i], costs[i]),
+	 * either into g or, if compressed is true, into cg (which reorders the
+	 * arcs).
+	 */
+	void build_lists(Graph &g, CompressedGraph &cg, avector<int> &tails,
+					 avector<int> &heads, avector<int> &costs) {
+		if (compressed) {
+			cg.build(n, tails, heads, &costs, &scratch);
+			stats.add(stat_adj_bytes, cg.memory());
+		} else {
+			g.build(n, tails, heads, &costs);
+			stats.add(stat_adj_bytes, g.memory());
+		}
+	}
+
 	/**
 	 * @brief
 	 * Time: O(n + m + k)
-	 * Space: O(n + m + k), for the adjacency lists (including portal_adj)
+	 * Space: O(m + k), for the arcs
 	 * 
-	 * Reads the input from the file.
+	 * Reads the input from the file, hashing it on the way.
 	 */
 	void read_input() {
+		stats.phase("read_input");
+
 		// Input file
-		ifstream fin("teleportare.in");
+		Reader fin("teleportare.in", io, sizeof(io));
 
 		// Reads n, m and k
 		fin >> n >> m >> k;
+		hash.add(n);
+		hash.add(m);
+		hash.add(k);
+		map_hash.add(n);
+		map_hash.add(m);
+		map_hash.add(k);
+
+		// Initializes the arcs
+		from.reserve(2 * m);
+		dest.reserve(2 * m);
+		weight.reserve(2 * m);
+		portal_from.reserve(2 * k);
+		portal_dest.reserve(2 * k);
+		period.reserve(2 * k);
 
 		// Reads the edges
         for (int i = 1, x, y, w; i <= m; ++i) {
 			fin >> x >> y >> w;
-			adj[x].push_back({y, w});
-			adj[y].push_back({x, w});
+			// Corridors and portals go both ways, and are told apart by
+			// the last field
+			hash.item(min(x, y), max(x, y), w, 0);
+			map_hash.item(min(x, y), max(x, y), w, 0);
+			from.insert(from.end(), {x, y});
+			dest.insert(dest.end(), {y, x});
+			weight.insert(weight.end(), {w, w});
 		}
 
 		// Reads the portals and computes the least common multiple
-		for (int i = 1, x, y, period; i <= k; ++i) {
-			fin >> x >> y >> period;
-			lcm_aux = lcm(lcm_aux, period);
+		for (int i = 1, x, y, p; i <= k; ++i) {
+			fin >> x >> y >> p;
+			hash.item(min(x, y), max(x, y), p, 1);
+			map_hash.item(min(x, y), max(x, y), p, 1);
+			lcm_aux = lcm(lcm_aux, p);
 
-			portal_adj[x].push_back({y, period});
-			portal_adj[y].push_back({x, period});
+			portal_from.insert(portal_from.end(), {x, y});
+			portal_dest.insert(portal_dest.end(), {y, x});
+			period.insert(period.end(), {p, p});
 		}
 
+		// Reads the queries, if any are listed (q is left 0 at the end of
+		// the file)
+		q = 0;
+		fin >> q;
+		hash.add(q);
+		listed = q > 0;
+		queries.reserve(max(q, 1));
+		for (int i = 1, x, y, t; i <= q; ++i) {
+			fin >> x >> y >> t;
+			hash.add(x);
+			hash.add(y);
+			hash.add(t);
+			queries.push_back({x, y, t});
+		}
+		if (!listed)
+			queries.push_back({1, n, 0});
+
 		// Closes the input file
 		fin.close();
 	}
@@ -104,27 +350,741 @@ class Task {
 	/**
 	 * @brief
 	 * Time: O(n + m + k)
+	 * Space: O(n + m + k), for the adjacency lists (including portal_adj)
+	 *
+	 * Relabels the nodes and builds the lists from the arcs read.
+	 */
+	void build() {
+		// Relabels the nodes, except for 1 and n, which changes no answer
+		if (reorder.enabled()) {
+			stats.phase("reorder");
+			reorder.relabel(stats, n, from, dest, {1, n}, &scratch);
+			reorder.apply(portal_from);
+			reorder.apply(portal_dest);
+			for (auto &query : queries) {
+				query[0] = reorder.id(query[0]);
+				query[1] = reorder.id(query[1]);
+			}
+		}
+
+		stats.phase("build_lists");
+		build_lists(adj, cadj, from, dest, weight);
+		build_lists(portal_adj, portal_cadj, portal_from, portal_dest, period);
+
+		// The arcs are not needed any more
+		from = avector<int>(&scratch);
+		dest = avector<int>(&scratch);
+		weight = avector<int>(&scratch);
+		portal_from = avector<int>(&scratch);
+		portal_dest = avector<int>(&scratch);
+		period = avector<int>(&scratch);
+		scratch.trim();
+	}
+
+	/**
+	 * @brief
+	 * Time: O(q * (n + m + k))
 	 * Space: O(n + m + k), overall
 	 * 
-	 * Computes the minimum cost to reach node n.
+	 * Answers every query (the minimum cost to reach node n, if none are
+	 * listed), or computes the arrival times for every departure time in
+	 * profile mode.
 	 *
-	 * @return The minimum cost to reach node n.
+	 * @return The answer of the first query (the minimum cost to reach node
+	 * n, if none are listed).
 	 */
 	long long get_result() {
+		if (profile) {
+			stats.phase("init");
+			P.assign((size_t)(n + 1) * lcm_aux, INF);
+
+			stats.phase("profile");
+			if (compressed)
+				profile_search(cadj, portal_cadj);
+			else
+				profile_search(adj, portal_adj);
+			return arrival[0];
+		}
+
+		// The overlay, if it is ready, serves the queries between its nodes
+		bool ready = use_overlay && (compressed ?
+									 prepare_overlay(cadj, portal_cadj) :
+									 prepare_overlay(adj, portal_adj));
+
+		// The searches of listed queries all go in one phase
+		if (listed)
+			stats.phase("queries");
+		for (auto &[source, target, departure] : queries) {
+			search_arena.reset();
+			answers.push_back(compressed ?
+				answer(cadj, portal_cadj, ready, source, target, departure) :
+				answer(adj, portal_adj, ready, source, target, departure));
+		}
+
+		return answers[0];
+	}
+
+	/**
+	 * @brief
+	 * Time: that of the search used
+	 *
+	 * Answers a query, over the overlay if it is ready and beats the usual
+	 * search, with the usual search otherwise.
+	 *
+	 * @param corridors The lists of the corridors (adj or cadj).
+	 * @param portals The lists of the portals (portal_adj or portal_cadj).
+	 * @param ready Whether the overlay is ready.
+	 * @return The minimum cost to reach target from source, departing at
+	 * time departure, or -1.
+	 */
+	template <class G>
+	long long answer(const G &corridors, const G &portals, bool ready,
+					 int source, int target, int departure) {
+		if (ready && (force_overlay ||
+					  overlay_cost(source, target) < search_work)) {
+			query_phase("overlay_search");
+			return overlay_search(corridors, portals, source, target,
+								  departure);
+		}
+
 		// Initializes the minimum cost to reach node i at time j with INF
+		query_phase("init");
+		P.assign((size_t)(n + 1) * lcm_aux, INF);
+
+		if (use_rows) {
+			query_phase("rows");
+			return rows(corridors, portals, source, target, departure);
+		}
+
+		query_phase("dijkstra");
+		return dijkstra(corridors, portals, source, target, departure);
+	}
+
+	// Starts a phase of a search, unless the queries are listed (their
+	// searches then share one phase)
+	void query_phase(const char *name) {
+		if (!listed)
+			stats.phase(name);
+	}
+
+	/**
+	 * @brief
+	 * Time: O(n * (n + m + k) * lcm_aux) in the worst case, usually far less
+	 * Auxiliary Space: O(n + m + k + lcm_aux), for the worklist and the masks
+	 *
+	 * Label-correcting search over whole rows: P[node * lcm_aux ...] is the
+	 * row of node, its costs for every time modulo lcm_aux. Going through a
+	 * corridor of cost w rotates a row by w lanes and adds w to every lane;
+	 * going through a portal of period p rotates it by 1 and adds 1, but
+	 * only from the lanes that are multiples of p (the others get INF added
+	 * by a mask). The rows are relaxed with SIMD (see rows.h), and a node
+	 * whose row got lower is queued again, until nothing changes. The rows
+	 * hold times (the departure time plus the costs).
+	 *
+	 * @param corridors The lists of the corridors (adj or cadj).
+	 * @param portals The lists of the portals (portal_adj or portal_cadj).
+	 * @return The minimum cost to reach target from source, departing at
+	 * time departure, or -1.
+	 */
+	template <class G>
+	long long rows(const G &corridors, const G &portals, int source,
+				   int target, int departure) {
+		// masks[p * lcm_aux + r] = 0 if r is a multiple of p, INF otherwise
+		int max_period = 1;
+		for (int i = 1; i <= n; ++i)
+			for (auto arc : portals.arcs(i))
+				max_period = max(max_period, arc.w);
+		avector<long long> masks((size_t)(max_period + 1) * lcm_aux, INF,
+								 &search_arena);
+		for (int p = 1; p <= max_period; ++p)
+			for (int r = 0; r < lcm_aux; r += p)
+				masks[(size_t)p * lcm_aux + r] = 0;
+
+		// The worklist holds the nodes whose rows got lower since they were
+		// last processed, by pending[i] = a lower bound of the new costs in
+		// the row of i (INF if there are none); the lowest one comes first,
+		// so that a row is seldom processed before its costs are final
+		avector<long long> pending(n + 1, INF, &search_arena);
+		priority_queue<pair<long long, int>, avector<pair<long long, int>>,
+						greater<pair<long long, int>>>
+			worklist{greater<pair<long long, int>>(),
+					 avector<pair<long long, int>>(&search_arena)};
+
+		// result = the minimum time to reach target found so far
+		long long result = INF;
+
+		state(source, departure) = departure;
+		pending[source] = departure;
+		worklist.push(make_pair((long long)departure, source));
+
+		while (!worklist.empty()) {
+			long long key = worklist.top().first;
+			int node = worklist.top().second;
+
+			// Every cost still to be found is at least key
+			if (key >= result)
+				break;
+
+			worklist.pop();
+			if (pending[node] != key)
+				continue;
+			pending[node] = INF;
+			stats.add(stat_rows);
+
+			// Nothing that starts from target arrives there any sooner
+			if (node == target)
+				continue;
+
+			// Only the new costs of the row, all of them at least key, can
+			// lower the rows of the neighbours
+			const long long *row = &P[(size_t)node * lcm_aux];
+			auto relax = [&](int neigh, int shift, long long w,
+							 const long long *mask) {
+				stats.add(stat_row_relaxations);
+				if (!Rows::relax_rotated(&P[(size_t)neigh * lcm_aux], row,
+										 lcm_aux, shift, w, mask))
+					return;
+
+				if (neigh == target)
+					result = *min_element(&state(target, 0),
+										  &state(target, 0) + lcm_aux);
+				if (key + w < pending[neigh]) {
+					pending[neigh] = key + w;
+					worklist.push(make_pair(key + w, neigh));
+				}
+			};
+
+			for (auto arc : corridors.arcs(node))
+				relax(arc.to, arc.w % lcm_aux, arc.w, nullptr);
+			for (auto arc : portals.arcs(node))
+				relax(arc.to, 1 % lcm_aux, 1,
+					  &masks[(size_t)arc.w * lcm_aux]);
+		}
+
+		// Also when source = target
+		result = min(result, state(target, departure));
+
+		return result == INF ? -1 : result - departure;
+	}
+
+	/**
+	 * @brief
+	 * Time: O((n + m + k) * lcm_aux * log)
+	 * Space: O(n * lcm_aux), for the priority queue
+	 *
+	 * Profile search: a single Dijkstra backwards from n, over the same
+	 * (node, time % lcm_aux) states, started from n at every time at once.
+	 * Afterwards, state(i, t) is the minimum time left to reach n from node
+	 * i at a time congruent to t, so departing from 1 at time t, one reaches n
+	 * at time t + state(1, t). Backwards, a corridor of cost w leads from
+	 * (node, t) to (neigh, t - w) and a portal of period p leads from
+	 * (node, t) to (neigh, t - 1), if t - 1 is a multiple of p.
+	 *
+	 * @param corridors The lists of the corridors (adj or cadj).
+	 * @param portals The lists of the portals (portal_adj or portal_cadj).
+	 */
+	template <class G>
+	void profile_search(const G &corridors, const G &portals) {
+		// The states are (node * lcm_aux + time), as the time left says
+		// nothing about the time itself
+		priority_queue<pair<long long, size_t>, avector<pair<long long, size_t>>,
+						greater<pair<long long, size_t>>>
+			pq{greater<pair<long long, size_t>>(),
+			   avector<pair<long long, size_t>>(&arena)};
+
+		for (int t = 0; t < lcm_aux; ++t) {
+			state(n, t) = 0;
+			pq.push(make_pair(0LL, (size_t)n * lcm_aux + t));
+			stats.add(stat_pushes);
+		}
+
+		while (!pq.empty()) {
+			long long cost_node = pq.top().first;
+			int node = pq.top().second / lcm_aux;
+			int time = pq.top().second % lcm_aux;
+
+			pq.pop();
+			stats.add(stat_pops);
+			if (P[(size_t)node * lcm_aux + time] < cost_node) {
+				stats.add(stat_stale_pops);
+				continue;
+			}
+
+			for (auto arc : corridors.arcs(node)) {
+				long long cost = cost_node + arc.w;
+				int before = ((time - arc.w) % lcm_aux + lcm_aux) % lcm_aux;
+				size_t prev = (size_t)arc.to * lcm_aux + before;
+
+				if (P[prev] <= cost)
+					continue;
+				P[prev] = cost;
+				pq.push(make_pair(cost, prev));
+				stats.add(stat_pushes);
+			}
+
+			int before = (time + lcm_aux - 1) % lcm_aux;
+			for (auto arc : portals.arcs(node)) {
+				size_t prev = (size_t)arc.to * lcm_aux + before;
+
+				if (before % arc.w || P[prev] <= cost_node + 1)
+					continue;
+				P[prev] = cost_node + 1;
+				pq.push(make_pair(cost_node + 1, prev));
+				stats.add(stat_pushes);
+			}
+		}
+
+		arrival.resize(lcm_aux);
+		for (int t = 0; t < lcm_aux; ++t)
+			arrival[t] = state(1, t) == INF ? -1 : t + state(1, t);
+	}
+
+	/**
+	 * @brief
+	 * Time: O(n + K * (n + m) * lcm_aux * log) if it is built, K = number of
+	 * overlay nodes; O(n + K^2 * lcm_aux) if it is loaded
+	 * Space: O(K^2 * lcm_aux), for overlay_dist
+	 *
+	 * Gets the overlay of the map ready: the nodes where the time matters
+	 * (the portal endpoints, plus 1 and n) and, between any two of them, the
+	 * shortest walks along corridors for every length modulo lcm_aux. The
+	 * overlay of an earlier solve or of the snapshot of the map is taken as
+	 * it is; otherwise it is built, if that costs less than what it saves on
+	 * the queries of this solve.
+	 *
+	 * @param corridors The lists of the corridors (adj or cadj).
+	 * @param portals The lists of the portals (portal_adj or portal_cadj).
+	 * @return Whether the overlay is ready.
+	 */
+	template <class G>
+	bool prepare_overlay(const G &corridors, const G &portals) {
+		// Picks the nodes
+		overlay_id.assign(n + 1, NIL);
 		for (int i = 1; i <= n; ++i) {
-			for (int j = 0; j <= lcm_aux; ++j) {
-				P[i][j] = INF;
+			if (i == 1 || i == n || portals.degree(i)) {
+				overlay_id[i] = overlay_node.size();
+				overlay_node.push_back(i);
+			}
+		}
+		size_t size = overlay_node.size();
+
+		// Estimates of the work, in states or walks: a search of the whole
+		// map goes through up to (n + 2m + 2k) * lcm_aux states, and the
+		// build through (n + 2m) * lcm_aux for every node of the overlay.
+		// A search of the overlay starts from one state and reaches the
+		// others through portals, up to lcm_aux / p of them through a portal
+		// of period p (portal_states in all); from each, it tries lcm_aux
+		// walks to target and portal_states walks to portals. The legs of a
+		// query whose ends are not in the overlay come on top of it (see
+		// overlay_cost()).
+		double portal_states = 0;
+		for (int i = 1; i <= n; ++i)
+			for (auto arc : portals.arcs(i))
+				portal_states += lcm_aux / arc.w;
+		search_work = (double)(n + 2 * m + 2 * k) * lcm_aux;
+		overlay_work = (1 + portal_states) * (lcm_aux + portal_states);
+		double build = (double)size * (n + 2 * m) * lcm_aux;
+
+		// saving = what the overlay saves on the queries of this solve
+		double saving = 0;
+		for (auto &[source, target, departure] : queries)
+			saving += max(0.0, search_work - overlay_cost(source, target));
+
+		if ((!force_overlay && saving <= 0) ||
+			size * size * lcm_aux > OVERLAY_MAX_DIST)
+			return false;
+
+		// The overlay of the same map, kept or in the snapshot, is used as
+		// it is; it is built otherwise, if it pays off within this solve
+		bool kept = overlay_key && overlay_key == map_hash.digest();
+		if (!kept && snapshot.enabled()) {
+			stats.phase("overlay_load");
+			kept = load_overlay();
+		}
+		if (!kept || !adopt_overlay()) {
+			if (!force_overlay && build > saving)
+				return false;
+
+			stats.phase("overlay_build");
+			build_overlay(corridors);
+		}
+
+		stats.add(stat_overlay_nodes, overlay_size);
+		return true;
+	}
+
+	/**
+	 * @brief
+	 * Time: O(1)
+	 *
+	 * @return The estimate of the work of a query over the overlay: the
+	 * search of the overlay, plus a walk of the map from source if it is not
+	 * in the overlay and a search of the plain distances to target if it is
+	 * not in it either (see overlay_search()).
+	 */
+	double overlay_cost(int source, int target) {
+		double cost = overlay_work;
+
+		if (overlay_id[source] == NIL)
+			cost += (double)(n + 2 * m) * lcm_aux;
+		if (overlay_id[target] == NIL)
+			cost += n + 2 * m;
+		return cost;
+	}
+
+	// Drops the overlay that is kept
+	void clear_overlay() {
+		overlay_original = avector<int>(&overlay_arena);
+		overlay_dist = avector<long long>(&overlay_arena);
+		overlay_key = 0;
+		overlay_size = 0;
+		overlay_arena.reset();
+	}
+
+	/**
+	 * @brief
+	 * Time: O(size of the snapshot)
+	 *
+	 * Copies the overlay out of the snapshot of the map, if there is one.
+	 *
+	 * @return whether it was found
+	 */
+	bool load_overlay() {
+		clear_overlay();
+		if (!snapshot.load(map_hash.digest(), 2))
+			return false;
+
+		size_t size, dists;
+		const int *node = snapshot.array<int>(0, size);
+		const long long *dist = snapshot.array<long long>(1, dists);
+		if (dists != size * size * lcm_aux)
+			return false;
+
+		overlay_original.assign(node, node + size);
+		overlay_dist.assign(dist, dist + dists);
+		overlay_size = size;
+		overlay_key = map_hash.digest();
+		return true;
+	}
+
+	/**
+	 * @brief
+	 * Time: O(K log K)
+	 *
+	 * Takes the order of the nodes of the overlay that is kept (in the
+	 * original ids), which must be the nodes picked for this solve.
+	 *
+	 * @return whether they are the same nodes
+	 */
+	bool adopt_overlay() {
+		if ((size_t)overlay_size != overlay_node.size())
+			return false;
+
+		avector<int> nodes(&arena);
+		for (int node : overlay_original) {
+			if (node < 1 || node > n)
+				return false;
+			nodes.push_back(reorder.enabled() ? reorder.id(node) : node);
+		}
+
+		// overlay_node is sorted, as the nodes were picked in order
+		avector<int> sorted(nodes, &arena);
+		sort(sorted.begin(), sorted.end());
+		if (sorted != overlay_node)
+			return false;
+
+		for (int a = 0; a < overlay_size; ++a) {
+			overlay_node[a] = nodes[a];
+			overlay_id[nodes[a]] = a;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief
+	 * Time: O(K * (n + m) * lcm_aux * log), K = number of overlay nodes
+	 * Space: O(K^2 * lcm_aux), for overlay_dist
+	 *
+	 * Builds the walks of the overlay, whose nodes were picked, and writes
+	 * it to the snapshot of the map. As one cannot wait in a room, the plain
+	 * shortest distance is not enough: a longer walk may be the one that
+	 * reaches a portal when it is open.
+	 *
+	 * @param corridors The lists of the corridors (adj or cadj).
+	 */
+	template <class G>
+	void build_overlay(const G &corridors) {
+		clear_overlay();
+
+		overlay_size = overlay_node.size();
+		for (int node : overlay_node)
+			overlay_original.push_back(reorder.enabled() ?
+									   reorder.original(node) : node);
+
+		// One search along corridors from every node of the overlay, whose
+		// results are copied out of P for the nodes of the overlay
+		size_t size = overlay_size;
+		overlay_dist.assign(size * size * lcm_aux, INF);
+		P.assign((size_t)(n + 1) * lcm_aux, INF);
+		for (int a = 0; a < overlay_size; ++a) {
+			search_arena.reset();
+			walk(corridors, overlay_node[a], INF, stat_overlay_states);
+
+			for (int b = 0; b < overlay_size; ++b)
+				copy_n(&state(overlay_node[b], 0), lcm_aux,
+					   &overlay_dist[((size_t)a * overlay_size + b) * lcm_aux]);
+		}
+
+		overlay_key = map_hash.digest();
+		snapshot.save(overlay_key,
+					  {{overlay_original.data(), size * sizeof(int)},
+					   {overlay_dist.data(),
+						overlay_dist.size() * sizeof(long long)}});
+	}
+
+	/**
+	 * @brief
+	 * Time: O((n + m) * lcm_aux * log)
+	 * Space: O(n * lcm_aux), for the priority queue
+	 *
+	 * Dijkstra over the (node, time % lcm_aux) states, along corridors
+	 * only, up to limit: afterwards, state(i, r) is the length of the
+	 * shortest walk from source to i whose length is r modulo lcm_aux, if it
+	 * is less than limit (INF otherwise).
+	 *
+	 * @param corridors The lists of the corridors (adj or cadj).
+	 * @param source The node where the walks start.
+	 * @param limit The length from which the walks are not needed.
+	 * @param stat The counter of the states popped.
+	 */
+	template <class G>
+	void walk(const G &corridors, int source, long long limit, int stat) {
+		priority_queue<pair<long long, int>, avector<pair<long long, int>>,
+						greater<pair<long long, int>>>
+			pq{greater<pair<long long, int>>(),
+			   avector<pair<long long, int>>(&search_arena)};
+
+		fill(P.begin(), P.end(), INF);
+		state(source, 0) = 0;
+		pq.push(make_pair(0LL, source));
+
+		while (!pq.empty()) {
+			int node = pq.top().second;
+			long long cost_node = pq.top().first;
+
+			pq.pop();
+			stats.add(stat);
+			if (state(node, cost_node) < cost_node)
+				continue;
+
+			for (auto arc : corridors.arcs(node)) {
+				long long cost = cost_node + arc.w;
+
+				if (cost >= limit || state(arc.to, cost) <= cost)
+					continue;
+				state(arc.to, cost) = cost;
+				pq.push(make_pair(cost, arc.to));
+			}
+		}
+	}
+
+	/**
+	 * @brief
+	 * Time: O((n + m) * log)
+	 * Space: O(n), for dist and the priority queue
+	 *
+	 * Dijkstra along corridors only, without the times: afterwards, dist[i]
+	 * is the length of the shortest walk between source and i (the same both
+	 * ways, as the corridors are), or INF.
+	 *
+	 * @param corridors The lists of the corridors (adj or cadj).
+	 */
+	template <class G>
+	void distances(const G &corridors, int source, avector<long long> &dist) {
+		priority_queue<pair<long long, int>, avector<pair<long long, int>>,
+						greater<pair<long long, int>>>
+			pq{greater<pair<long long, int>>(),
+			   avector<pair<long long, int>>(&search_arena)};
+
+		dist.assign(n + 1, INF);
+		dist[source] = 0;
+		pq.push(make_pair(0LL, source));
+
+		while (!pq.empty()) {
+			int node = pq.top().second;
+			long long cost_node = pq.top().first;
+
+			pq.pop();
+			stats.add(stat_pops);
+			if (dist[node] < cost_node)
+				continue;
+
+			for (auto arc : corridors.arcs(node)) {
+				if (dist[arc.to] <= cost_node + arc.w)
+					continue;
+				dist[arc.to] = cost_node + arc.w;
+				pq.push(make_pair(cost_node + arc.w, arc.to));
+			}
+		}
+	}
+
+	/**
+	 * @brief
+	 * Time: O(K * lcm_aux * (K + k * lcm_aux) * log), plus the legs
+	 * Space: O(K * lcm_aux), for the states and the priority queue
+	 *
+	 * Dijkstra over the overlay: a state is an overlay node reached at the
+	 * start or through a portal, at some time modulo lcm_aux. From there,
+	 * every walk to another overlay node is tried, either ending at target
+	 * or followed by one of its portals, if the walk reaches it when it is
+	 * open. The ends of the query that are not in the overlay are joined to
+	 * it by legs along corridors: a walk from source (see walk()) gives the
+	 * first portals taken, and the plain distances to target (see
+	 * distances()) take the place of the walks to target.
+	 *
+	 * @param corridors The lists of the corridors (adj or cadj).
+	 * @param portals The lists of the portals (portal_adj or portal_cadj).
+	 * @return The minimum cost to reach target from source, departing at
+	 * time departure, or -1.
+	 */
+	template <class G>
+	long long overlay_search(const G &corridors, const G &portals, int source,
+							 int target, int departure) {
+		priority_queue<pair<long long, int>, avector<pair<long long, int>>,
+						greater<pair<long long, int>>>
+			pq{greater<pair<long long, int>>(),
+			   avector<pair<long long, int>>(&search_arena)};
+
+		// best[a * lcm_aux + t] = the minimum cost to reach overlay node a,
+		// at a time congruent to t, at the start or through a portal
+		avector<long long> best((size_t)overlay_size * lcm_aux, INF,
+								&search_arena);
+
+		// result = the minimum cost to reach target found so far
+		long long result = INF;
+
+		// Adds the state of overlay node a at a time congruent to t
+		auto push = [&](int a, int t, long long cost) {
+			size_t next = (size_t)a * lcm_aux + t;
+
+			if (best[next] <= cost)
+				return;
+			best[next] = cost;
+			pq.push(make_pair(cost, (int)next));
+			stats.add(stat_pushes);
+		};
+
+		// to_target[i] = the length of the shortest walk from i to target,
+		// if target is not in the overlay; the one from source is already
+		// an answer
+		avector<long long> to_target(&search_arena);
+		if (overlay_id[target] == NIL) {
+			distances(corridors, target, to_target);
+			result = to_target[source];
+		}
+
+		if (overlay_id[source] != NIL) {
+			push(overlay_id[source], departure % lcm_aux, 0);
+		} else {
+			// The walks from source that are shorter than the answer found,
+			// to target or to a portal that is open when they reach it
+			if (P.size() != (size_t)(n + 1) * lcm_aux)
+				P.assign((size_t)(n + 1) * lcm_aux, INF);
+			walk(corridors, source, result, stat_pops);
+
+			for (int b = 0; b < overlay_size; ++b) {
+				const long long *to_b = &state(overlay_node[b], 0);
+
+				if (overlay_node[b] == target)
+					result = min(result, *min_element(to_b, to_b + lcm_aux));
+
+				for (auto arc : portals.arcs(overlay_node[b]))
+					for (int r = 0; r < lcm_aux; ++r)
+						if (to_b[r] != INF && (departure + r) % arc.w == 0)
+							push(overlay_id[arc.to],
+								 (departure + r + 1) % lcm_aux, to_b[r] + 1);
+			}
+		}
+
+		while (!pq.empty()) {
+			long long cost_node = pq.top().first;
+			int a = pq.top().second / lcm_aux, t = pq.top().second % lcm_aux;
+
+			pq.pop();
+			stats.add(stat_pops);
+
+			// Every later state costs at least as much
+			if (cost_node >= result)
+				break;
+			if (best[(size_t)a * lcm_aux + t] < cost_node) {
+				stats.add(stat_stale_pops);
+				continue;
+			}
+
+			const long long *dist =
+				&overlay_dist[(size_t)a * overlay_size * lcm_aux];
+
+			// Walks to target
+			if (overlay_id[target] == NIL) {
+				result = min(result, cost_node + to_target[overlay_node[a]]);
+			} else {
+				const long long *to_b =
+					dist + (size_t)overlay_id[target] * lcm_aux;
+
+				for (int r = 0; r < lcm_aux; ++r)
+					result = min(result, cost_node + to_b[r]);
+			}
+
+			// Walks to b, then through a portal of b to neigh; the portal is
+			// open if t + r is a multiple of its period
+			for (int b = 0; b < overlay_size; ++b) {
+				const long long *to_b = dist + (size_t)b * lcm_aux;
+
+				for (auto arc : portals.arcs(overlay_node[b])) {
+					int period = arc.w;
+					int neigh = overlay_id[arc.to];
+
+					for (int r = (period - t % period) % period; r < lcm_aux;
+						 r += period) {
+						if (to_b[r] == INF)
+							continue;
+
+						push(neigh, (t + r + 1) % lcm_aux,
+							 cost_node + to_b[r] + 1);
+					}
+				}
 			}
 		}
 
+		return result == INF ? -1 : result;
+	}
+
+	/**
+	 * @brief
+	 * Time: O(n + m + k)
+	 * Space: O(n + m + k), for the priority queue
+	 *
+	 * Dijkstra over the (node, time % lcm_aux) states. The costs in the
+	 * queue and in P are times (the departure time plus the costs).
+	 *
+	 * @param corridors The lists of the corridors (adj or cadj).
+	 * @param portals The lists of the portals (portal_adj or portal_cadj).
+	 * @return The minimum cost to reach target from source, departing at
+	 * time departure, or -1.
+	 */
+	template <class G>
+	long long dijkstra(const G &corridors, const G &portals, int source,
+					   int target, int departure) {
 		// min_queue (by default -> max_queue)
 		// Compares using the first element of the pair
-		priority_queue<pair<long long, int>, vector<pair<long long, int>>,
-						greater<pair<long long, int>>> pq;
+		priority_queue<pair<long long, int>, avector<pair<long long, int>>,
+						greater<pair<long long, int>>>
+			pq{greater<pair<long long, int>>(),
+			   avector<pair<long long, int>>(&search_arena)};
 
 		// Adds the first node to the queue
-		pq.push(make_pair(0LL, 1));
+		pq.push(make_pair((long long)departure, source));
+		stats.add(stat_pushes);
 
 		int node, neigh, cost, period;
 		long long cost_node;
@@ -137,55 +1097,60 @@ class Task {
 
 			// Removes the node from the queue
 			pq.pop();
+			stats.add(stat_pops);
 
 			// If the node is the destination, returns the minimum cost
-			if (node == n)
-				return cost_node;
+			if (node == target)
+				return cost_node - departure;
 
 			// If the minimum cost to reach the node at time
 			// cost_node % lcm_aux is less than the current cost,
 			// then the node was already visited
-			if (P[node][cost_node % lcm_aux] < cost_node)
+			if (state(node, cost_node) < cost_node) {
+				stats.add(stat_stale_pops);
 				continue;
+			}
 
 			// For each neighbour of the current node
-			for (auto neigh_w : adj[node]) {
+			for (auto arc : corridors.arcs(node)) {
 				// neigh = neighbour, cost = cost of the arc (node, neigh)
-				neigh = neigh_w.first;
-				cost = neigh_w.second;
+				neigh = arc.to;
+				cost = arc.w;
 
 				// If the minimum cost to reach node neigh at time
 				// (cost_node + cost) % lcm_aux is less than or equal to the
 				// current cost, then the node was already visited
-				if (P[neigh][(cost_node + cost) % lcm_aux] <= cost_node + cost)
+				if (state(neigh, cost_node + cost) <= cost_node + cost)
 					continue;
 
 				// Updates the minimum cost to reach node neigh at time
-				P[neigh][(cost_node + cost) % lcm_aux] = cost_node + cost;
+				state(neigh, cost_node + cost) = cost_node + cost;
 
 				// Adds the node to the queue
 				pq.push(make_pair(cost_node + cost, neigh));
+				stats.add(stat_pushes);
 			}
 
 			// For each portal of the current node
-			for (auto neigh_w : portal_adj[node]) {
+			for (auto arc : portals.arcs(node)) {
 				// neigh = neighbour, period = period of the portal
-				neigh = neigh_w.first;
-				period = neigh_w.second;
+				neigh = arc.to;
+				period = arc.w;
 
 				// 1 is the cost of the portal
 				// If the minimum cost to reach node neigh at time
 				// (cost_node + 1) % lcm_aux is less than or equal to the
 				// current cost, then the node was already visited
-				if (P[neigh][(cost_node + 1) % lcm_aux] <= cost_node + 1)
+				if (state(neigh, cost_node + 1) <= cost_node + 1)
 					continue;
 
 				// Updates the minimum cost to reach node neigh at time
 				// (cost_node + 1) % lcm_aux and adds the node to the queue
 				// if the time is a multiple of the period
 				if (cost_node % period == 0) {
-					P[neigh][(cost_node + 1) % lcm_aux] = cost_node + 1;
+					state(neigh, cost_node + 1) = cost_node + 1;
 					pq.push(make_pair(cost_node + 1, neigh));
+					stats.add(stat_pushes);
 				}
 			}
 		}
@@ -194,19 +1159,30 @@ class Task {
 	}
 
 	/**
-	 * @brief Prints the result.
+	 * @brief Prints the result, the answers of the listed queries (one per
+	 * line), or the profile, as "t arrival[t]" lines.
 	 *
 	 * @param result The minimum cost to reach node n.
 	 */
 	void print_output(long long result) {
-		ofstream fout("teleportare.out");
+		stats.phase("print_output");
 
-		fout << result << "\n";
+		Writer fout("teleportare.out", io, sizeof(io));
+
+		if (profile) {
+			for (int t = 0; t < lcm_aux; ++t)
+				fout << t << ' ' << arrival[t] << "\n";
+		} else if (listed) {
+			for (auto answer : answers)
+				fout << answer << "\n";
+		} else {
+			fout << result << "\n";
+		}
 		fout.close();
 	}
 };
 
-int main() {
+int main(int argc, char *argv[]) {
 	auto* task = new (nothrow) Task();
 
 	if (!task) {
@@ -214,7 +1190,21 @@ int main() {
 		return -1;
 	}
 
-	task->solve();
+	// runs = how many times the input is solved (1 by default); with more
+	// than one, the heap allocations of every run are reported, which should
+	// drop to 0 once the arena is warm
+	int runs = argc > 1 ? atoi(argv[1]) : 1;
+
+	for (int run = 1; run <= runs; ++run) {
+		size_t allocations = task->heap_allocations();
+
+		task->solve();
+
+		if (runs > 1)
+			cerr << "run " << run << ": "
+				 << task->heap_allocations() - allocations
+				 << " heap allocations\n";
+	}
 
 	delete task;
 